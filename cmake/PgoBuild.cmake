@@ -0,0 +1,48 @@
+# Builds the release and pgo-use presets, trains the profile in between and reports the PGO + LTO speedup
+# of every benchmark that touches a raster loop.
+# Usage, from the repository root: cmake -P cmake/PgoBuild.cmake
+
+get_filename_component(SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+
+function(run)
+    execute_process(COMMAND ${ARGV} WORKING_DIRECTORY "${SOURCE_DIR}" COMMAND_ERROR_IS_FATAL ANY)
+endfunction()
+
+# Single config generators put the tools next to the resources, multi config ones in a folder per configuration
+function(find_bench BUILD_DIR RESULT)
+    foreach(CANDIDATE "rasterizer_bench" "rasterizer_bench.exe" "Release/rasterizer_bench.exe")
+        if(EXISTS "${BUILD_DIR}/project/${CANDIDATE}")
+            set(${RESULT} "${BUILD_DIR}/project/${CANDIDATE}" PARENT_SCOPE)
+            return()
+        endif()
+    endforeach()
+    message(FATAL_ERROR "No rasterizer_bench in ${BUILD_DIR}")
+endfunction()
+
+set(BENCH_ARGUMENTS "--filter=Render/" "--min-time=2")
+set(BASELINE_JSON "${SOURCE_DIR}/out/pgo-release.json")
+set(PGO_JSON "${SOURCE_DIR}/out/pgo-use.json")
+
+message(STATUS "Release baseline")
+run(${CMAKE_COMMAND} --preset release)
+run(${CMAKE_COMMAND} --build --preset release --target rasterizer_bench)
+
+message(STATUS "Instrumented build and training")
+file(REMOVE_RECURSE "${SOURCE_DIR}/out/build/pgo/pgo")
+run(${CMAKE_COMMAND} --preset pgo-generate)
+run(${CMAKE_COMMAND} --build --preset pgo-generate)
+run(${CMAKE_COMMAND} --build --preset pgo-train)
+
+message(STATUS "Optimized build")
+run(${CMAKE_COMMAND} --preset pgo-use)
+run(${CMAKE_COMMAND} --build --preset pgo-use)
+
+find_bench("${SOURCE_DIR}/out/build/release" RELEASE_BENCH)
+find_bench("${SOURCE_DIR}/out/build/pgo" PGO_BENCH)
+
+message(STATUS "Release")
+execute_process(COMMAND "${RELEASE_BENCH}" ${BENCH_ARGUMENTS} "--json=${BASELINE_JSON}"
+    WORKING_DIRECTORY "${SOURCE_DIR}/out/build/release/project" COMMAND_ERROR_IS_FATAL ANY)
+message(STATUS "PGO + LTO against release")
+execute_process(COMMAND "${PGO_BENCH}" ${BENCH_ARGUMENTS} "--json=${PGO_JSON}" "--baseline=${BASELINE_JSON}"
+    WORKING_DIRECTORY "${SOURCE_DIR}/out/build/pgo/project" COMMAND_ERROR_IS_FATAL ANY)
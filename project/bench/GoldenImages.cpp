@@ -0,0 +1,273 @@
+// Renders fixed scene, rotation and display mode combinations headlessly and compares them with stored golden images.
+// Usage: rasterizer_golden [--update] [--dir=<folder>] [--filter=<substring>] [--tolerance=<0-255>]
+//                          [--max-bad-pixels=<fraction>] [--min-psnr=<dB>] [--shading-rate=<full|2x2|4x4|adaptive>]
+// --update writes the goldens with the forward path, otherwise every render path is compared against them.
+// Goldens are written at full shading rate, comparing coarser rates against them reports what they cost in image error
+// next to the share of pixels they still shade.
+// The reference set lives in golden/ next to this folder and is found there by default, PNG keeps it small enough to commit.
+// Run from the directory holding resources/, exits with 1 when any image fails.
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "Maths.h"
+#include "Renderer.h"
+#include "Timer.h"
+
+#undef main
+
+#ifndef RASTERIZER_GOLDEN_DIR
+#define RASTERIZER_GOLDEN_DIR "golden"
+#endif
+
+using namespace dae;
+
+namespace
+{
+	struct GoldenCase
+	{
+		std::string name;
+		Renderer::SceneType scene;
+		float rotation;
+		Renderer::DisplayMode displayMode;
+		Renderer::ShadingMode shadingMode;
+	};
+
+	struct Comparison
+	{
+		int maxDifference{};
+		// Pixels with any channel further than the tolerance from the golden
+		double badPixelFraction{};
+		double psnr{};
+	};
+
+	std::vector<GoldenCase> MakeCases()
+	{
+		const std::pair<Renderer::SceneType, const char*> scenes[]{
+			{ Renderer::SceneType::Vehicle, "vehicle" },
+			{ Renderer::SceneType::VehicleGrid, "vehicle_grid" },
+			{ Renderer::SceneType::JinxCrowd, "jinx_crowd" },
+			{ Renderer::SceneType::ParkingLot, "parking_lot" },
+			{ Renderer::SceneType::TukTuk, "tuktuk" }
+		};
+		const int rotations[]{ 0, 135 };
+		const std::tuple<Renderer::DisplayMode, Renderer::ShadingMode, const char*> modes[]{
+			{ Renderer::DisplayMode::FinalColor, Renderer::ShadingMode::Combined, "final_color" },
+			{ Renderer::DisplayMode::DepthBuffer, Renderer::ShadingMode::Combined, "depth" },
+			{ Renderer::DisplayMode::ShadingMode, Renderer::ShadingMode::ObservedArea, "observed_area" },
+			{ Renderer::DisplayMode::ShadingMode, Renderer::ShadingMode::Diffuse, "diffuse" },
+			{ Renderer::DisplayMode::ShadingMode, Renderer::ShadingMode::Specular, "specular" },
+			{ Renderer::DisplayMode::ShadingMode, Renderer::ShadingMode::Combined, "combined" }
+		};
+
+		std::vector<GoldenCase> cases{};
+		for (const auto& [scene, sceneName] : scenes)
+		{
+			for (const int rotation : rotations)
+			{
+				for (const auto& [displayMode, shadingMode, modeName] : modes)
+				{
+					cases.push_back({ std::string{ sceneName } + "_" + std::to_string(rotation) + "_" + modeName,
+						scene, rotation * TO_RADIANS, displayMode, shadingMode });
+				}
+			}
+		}
+		return cases;
+	}
+
+	Comparison Compare(SDL_Surface* pImage, SDL_Surface* pGolden, int tolerance)
+	{
+		Comparison comparison{};
+		double squaredError{};
+		int64_t badPixels{};
+
+		const int64_t pixelCount{ int64_t{ pImage->w } * pImage->h };
+		for (int y{ 0 }; y < pImage->h; ++y)
+		{
+			const uint32_t* pImageRow{ reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(pImage->pixels) + y * pImage->pitch) };
+			const uint32_t* pGoldenRow{ reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(pGolden->pixels) + y * pGolden->pitch) };
+			for (int x{ 0 }; x < pImage->w; ++x)
+			{
+				uint8_t image[3]{}, golden[3]{};
+				SDL_GetRGB(pImageRow[x], pImage->format, &image[0], &image[1], &image[2]);
+				SDL_GetRGB(pGoldenRow[x], pGolden->format, &golden[0], &golden[1], &golden[2]);
+
+				int pixelDifference{};
+				for (int channel{ 0 }; channel < 3; ++channel)
+				{
+					const int difference{ std::abs(image[channel] - golden[channel]) };
+					pixelDifference = std::max(pixelDifference, difference);
+					squaredError += static_cast<double>(difference) * difference;
+				}
+				comparison.maxDifference = std::max(comparison.maxDifference, pixelDifference);
+				if (pixelDifference > tolerance) ++badPixels;
+			}
+		}
+
+		comparison.badPixelFraction = static_cast<double>(badPixels) / static_cast<double>(pixelCount);
+		const double meanSquaredError{ squaredError / (3. * static_cast<double>(pixelCount)) };
+		comparison.psnr = meanSquaredError > 0. ? 10. * std::log10(255. * 255. / meanSquaredError) : INFINITY;
+		return comparison;
+	}
+
+	void Render(Renderer& renderer, Timer& timer, const GoldenCase& goldenCase)
+	{
+		if (renderer.GetScene() != goldenCase.scene) renderer.SetScene(goldenCase.scene);
+		renderer.SetRotation(goldenCase.rotation);
+		renderer.SetDisplayMode(goldenCase.displayMode);
+		renderer.SetShadingMode(goldenCase.shadingMode);
+		renderer.Update(&timer);
+		// Adaptive shading picks each tile's rate from the frame before, which has to show the same view
+		if (renderer.GetShadingRate() == Renderer::ShadingRate::Adaptive) renderer.Render();
+		renderer.Render();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool isUpdating{ false };
+	std::string directory{ RASTERIZER_GOLDEN_DIR };
+	std::string filter{};
+	int tolerance{ 2 };
+	double maxBadPixels{ .001 };
+	double minPsnr{ 40. };
+	Renderer::ShadingRate shadingRate{ Renderer::ShadingRate::Full };
+	const std::pair<std::string, Renderer::ShadingRate> shadingRates[]{
+		{ "full", Renderer::ShadingRate::Full },
+		{ "2x2", Renderer::ShadingRate::Coarse2x2 },
+		{ "4x4", Renderer::ShadingRate::Coarse4x4 },
+		{ "adaptive", Renderer::ShadingRate::Adaptive }
+	};
+	const auto findShadingRate = [&](const std::string& name)
+	{
+		return std::find_if(std::begin(shadingRates), std::end(shadingRates), [&](const auto& rate) { return rate.first == name; });
+	};
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ argv[i] };
+		if (argument == "--update") isUpdating = true;
+		else if (argument.rfind("--dir=", 0) == 0) directory = argument.substr(6);
+		else if (argument.rfind("--filter=", 0) == 0) filter = argument.substr(9);
+		else if (argument.rfind("--tolerance=", 0) == 0) tolerance = std::stoi(argument.substr(12));
+		else if (argument.rfind("--max-bad-pixels=", 0) == 0) maxBadPixels = std::stod(argument.substr(17));
+		else if (argument.rfind("--min-psnr=", 0) == 0) minPsnr = std::stod(argument.substr(11));
+		else if (argument.rfind("--shading-rate=", 0) == 0 && findShadingRate(argument.substr(15)) != std::end(shadingRates))
+		{
+			shadingRate = findShadingRate(argument.substr(15))->second;
+		}
+		else
+		{
+			std::cout << "Usage: rasterizer_golden [--update] [--dir=<folder>] [--filter=<substring>] [--tolerance=<0-255>]"
+				" [--max-bad-pixels=<fraction>] [--min-psnr=<dB>] [--shading-rate=<full|2x2|4x4|adaptive>]" << std::endl;
+			return 1;
+		}
+	}
+
+	Renderer renderer{ 640, 480 };
+	renderer.SetIsRotating(false);
+	// Every image has to show the state set right before its Render, rendered again even when it is the same
+	renderer.SetIsPipelined(false);
+	renderer.SetIsFrameSkipping(false);
+	Timer timer{};
+	timer.Start();
+	timer.Update();
+
+	std::vector<GoldenCase> cases{ MakeCases() };
+	std::erase_if(cases, [&](const GoldenCase& goldenCase) { return !filter.empty() && goldenCase.name.find(filter) == std::string::npos; });
+
+	if (isUpdating)
+	{
+		std::filesystem::create_directories(directory);
+		renderer.SetRenderPath(Renderer::RenderPath::Forward);
+		renderer.SetShadingRate(Renderer::ShadingRate::Full);
+		for (const GoldenCase& goldenCase : cases)
+		{
+			Render(renderer, timer, goldenCase);
+			const std::string path{ directory + "/" + goldenCase.name + ".png" };
+			if (IMG_SavePNG(renderer.GetBackBuffer(), path.c_str()) != 0)
+			{
+				std::cerr << "Could not write " << path << ": " << SDL_GetError() << std::endl;
+				return 1;
+			}
+		}
+		std::cout << "Wrote " << cases.size() << " golden images to " << directory << std::endl;
+		return 0;
+	}
+
+	const std::pair<Renderer::RenderPath, const char*> renderPaths[]{
+		{ Renderer::RenderPath::Forward, "forward" },
+		{ Renderer::RenderPath::DepthPrepass, "prepass" },
+		{ Renderer::RenderPath::VisibilityBuffer, "visibility" }
+	};
+
+	renderer.SetShadingRate(shadingRate);
+	int failures{};
+	// Shading invocations against all pixels that got a color, and the lowest PSNR, over every image
+	int64_t pixelsShaded{}, pixelsColored{};
+	double worstPsnr{ INFINITY };
+	std::cout << std::left << std::setw(44) << "Image" << std::setw(12) << "Path" << std::right << std::setw(10) << "Max diff"
+		<< std::setw(12) << "Bad pixels" << std::setw(10) << "PSNR" << std::setw(10) << "Shaded" << std::endl;
+	for (const GoldenCase& goldenCase : cases)
+	{
+		const std::string path{ directory + "/" + goldenCase.name + ".png" };
+		SDL_Surface* pLoaded{ IMG_Load(path.c_str()) };
+		if (!pLoaded)
+		{
+			std::cout << std::left << std::setw(44) << goldenCase.name << "MISSING, run with --update on a known good build" << std::endl;
+			++failures;
+			continue;
+		}
+		SDL_Surface* pGolden{ SDL_ConvertSurface(pLoaded, renderer.GetBackBuffer()->format, 0) };
+		SDL_FreeSurface(pLoaded);
+
+		for (const auto& [renderPath, pathName] : renderPaths)
+		{
+			renderer.SetRenderPath(renderPath);
+			Render(renderer, timer, goldenCase);
+
+			SDL_Surface* pImage{ renderer.GetBackBuffer() };
+			if (!pGolden || pGolden->w != pImage->w || pGolden->h != pImage->h)
+			{
+				std::cout << std::left << std::setw(44) << goldenCase.name << std::setw(12) << pathName << "SIZE MISMATCH" << std::endl;
+				++failures;
+				continue;
+			}
+
+			const Comparison comparison{ Compare(pImage, pGolden, tolerance) };
+			const bool isPassing{ comparison.badPixelFraction <= maxBadPixels && comparison.psnr >= minPsnr };
+			if (!isPassing) ++failures;
+
+			const Renderer::FrameStats& frameStats{ renderer.GetFrameStats() };
+			const int colored{ frameStats.pixelsShaded + frameStats.pixelsBroadcast };
+			pixelsShaded += frameStats.pixelsShaded;
+			pixelsColored += colored;
+			worstPsnr = std::min(worstPsnr, comparison.psnr);
+
+			std::cout << std::left << std::setw(44) << goldenCase.name << std::setw(12) << pathName << std::right
+				<< std::setw(10) << comparison.maxDifference
+				<< std::setw(11) << std::fixed << std::setprecision(3) << comparison.badPixelFraction * 100. << "%"
+				<< std::setw(10) << std::setprecision(1) << comparison.psnr
+				<< std::setw(9) << (colored > 0 ? 100. * frameStats.pixelsShaded / colored : 100.) << "%"
+				<< (isPassing ? "" : "  FAIL") << std::endl;
+		}
+		SDL_FreeSurface(pGolden);
+	}
+
+	if (pixelsColored > 0)
+	{
+		std::cout << "Shading invocations: " << std::setprecision(1) << 100. * static_cast<double>(pixelsShaded) / static_cast<double>(pixelsColored)
+			<< "% of the pixels colored, worst PSNR: " << worstPsnr << " dB" << std::endl;
+	}
+	std::cout << (failures == 0 ? "All images match" : std::to_string(failures) + " image(s) failed") << std::endl;
+	return failures == 0 ? 0 : 1;
+}
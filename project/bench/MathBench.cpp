@@ -0,0 +1,186 @@
+// Compares the inline math back end against the previous out-of-line scalar code.
+// Prints ns per operation for both and the largest difference between their results.
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Maths.h"
+#include "ScalarMath.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr size_t POINT_COUNT{ 1 << 16 };
+	constexpr int REPETITIONS{ 64 };
+	constexpr int RUNS{ 5 };
+
+	// Fixed parameters fold to a constant matrix
+	constexpr Matrix CONSTANT_PROJECTION{ Matrix::CreatePerspectiveFovLH(1.f, 4.f / 3.f, .1f, 100.f) };
+	static_assert(CONSTANT_PROJECTION[0][0] == .75f && CONSTANT_PROJECTION[2][3] == 1.f);
+	static_assert(CONSTANT_PROJECTION.TransformPoint(Vector4{ 0.f, 0.f, 100.f, 1.f }).z == 100.f);
+
+	// Best of RUNS, in nanoseconds per operation
+	template<typename Function>
+	double Measure(size_t operationsPerRepetition, Function&& function)
+	{
+		double best{ DBL_MAX };
+		for (int run{ 0 }; run < RUNS; ++run)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (int repetition{ 0 }; repetition < REPETITIONS; ++repetition)
+			{
+				function();
+			}
+			const auto end = std::chrono::steady_clock::now();
+
+			const double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+			best = std::min(best, nanoseconds / (static_cast<double>(operationsPerRepetition) * REPETITIONS));
+		}
+		return best;
+	}
+
+	float MaxDifference(const Vector3& a, const Vector3& b)
+	{
+		return std::max({ std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z) });
+	}
+
+	float MaxDifference(const Vector4& a, const Vector4& b)
+	{
+		return std::max({ std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z), std::abs(a.w - b.w) });
+	}
+
+	void PrintResult(const std::string& name, double scalarTime, double currentTime, float maxDifference)
+	{
+		std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+			<< std::setw(10) << std::setprecision(2) << scalarTime
+			<< std::setw(10) << std::setprecision(2) << currentTime
+			<< std::setw(9) << std::setprecision(2) << scalarTime / currentTime << "x"
+			<< std::setw(14) << std::scientific << std::setprecision(2) << maxDifference << std::endl;
+	}
+}
+
+int main()
+{
+	std::mt19937 random{ 1234 };
+	std::uniform_real_distribution<float> distribution{ -100.f, 100.f };
+
+	std::vector<Vector3> points(POINT_COUNT);
+	for (Vector3& point : points)
+	{
+		point = { distribution(random), distribution(random), distribution(random) };
+	}
+
+	const Matrix world{ Matrix::CreateScale(1.5f, 1.5f, 1.5f) * Matrix::CreateRotation(0.3f, 1.2f, -0.4f) * Matrix::CreateTranslation(5.f, -2.f, 30.f) };
+	const Matrix view{ Matrix::CreateLookAtLH({ 0.f, 5.f, -50.f }, { 0.f, -0.1f, 1.f }, Vector3::UnitY) };
+	const Matrix projection{ Matrix::CreatePerspectiveFovLH(std::tan(0.5f * 45.f * TO_RADIANS), 4.f / 3.f, .1f, 100.f) };
+	const Matrix worldViewProjection{ world * view * projection };
+
+	std::vector<Vector3> scalarPoints3(POINT_COUNT), points3(POINT_COUNT);
+	std::vector<Vector4> scalarPoints4(POINT_COUNT), points4(POINT_COUNT);
+
+#if DAE_SIMD_LEVEL == DAE_SIMD_AVX
+	std::cout << "Math back end: AVX" << std::endl;
+#elif DAE_SIMD_LEVEL == DAE_SIMD_SSE
+	std::cout << "Math back end: SSE" << std::endl;
+#else
+	std::cout << "Math back end: SCALAR" << std::endl;
+#endif
+	std::cout << std::left << std::setw(28) << "ns/op" << std::right
+		<< std::setw(10) << "scalar" << std::setw(10) << "current" << std::setw(10) << "speedup" << std::setw(14) << "max diff" << std::endl;
+
+	// Vector3 point transform
+	{
+		const double scalarTime = Measure(POINT_COUNT, [&]
+			{
+				for (size_t i{ 0 }; i < POINT_COUNT; ++i) scalarPoints3[i] = scalar::TransformPoint(worldViewProjection, points[i]);
+			});
+		const double currentTime = Measure(POINT_COUNT, [&]
+			{
+				for (size_t i{ 0 }; i < POINT_COUNT; ++i) points3[i] = worldViewProjection.TransformPoint(points[i]);
+			});
+
+		float maxDifference{ 0.f };
+		for (size_t i{ 0 }; i < POINT_COUNT; ++i) maxDifference = std::max(maxDifference, MaxDifference(scalarPoints3[i], points3[i]));
+		PrintResult("TransformPoint (Vector3)", scalarTime, currentTime, maxDifference);
+	}
+
+	// Direction transform
+	{
+		const double scalarTime = Measure(POINT_COUNT, [&]
+			{
+				for (size_t i{ 0 }; i < POINT_COUNT; ++i) scalarPoints3[i] = scalar::TransformVector(world, points[i]);
+			});
+		const double currentTime = Measure(POINT_COUNT, [&]
+			{
+				for (size_t i{ 0 }; i < POINT_COUNT; ++i) points3[i] = world.TransformVector(points[i]);
+			});
+
+		float maxDifference{ 0.f };
+		for (size_t i{ 0 }; i < POINT_COUNT; ++i) maxDifference = std::max(maxDifference, MaxDifference(scalarPoints3[i], points3[i]));
+		PrintResult("TransformVector", scalarTime, currentTime, maxDifference);
+	}
+
+	// Vertex shader style transform to clip space, one call per vertex
+	{
+		const double scalarTime = Measure(POINT_COUNT, [&]
+			{
+				for (size_t i{ 0 }; i < POINT_COUNT; ++i) scalarPoints4[i] = scalar::TransformPoint(worldViewProjection, Vector4{ points[i], 1.f });
+			});
+		const double currentTime = Measure(POINT_COUNT, [&]
+			{
+				for (size_t i{ 0 }; i < POINT_COUNT; ++i) points4[i] = worldViewProjection.TransformPoint(Vector4{ points[i], 1.f });
+			});
+
+		float maxDifference{ 0.f };
+		for (size_t i{ 0 }; i < POINT_COUNT; ++i) maxDifference = std::max(maxDifference, MaxDifference(scalarPoints4[i], points4[i]));
+		PrintResult("TransformPoint (Vector4)", scalarTime, currentTime, maxDifference);
+	}
+
+	// Same transform through the batched call
+	{
+		const double scalarTime = Measure(POINT_COUNT, [&]
+			{
+				for (size_t i{ 0 }; i < POINT_COUNT; ++i) scalarPoints4[i] = scalar::TransformPoint(worldViewProjection, Vector4{ points[i], 1.f });
+			});
+		const double currentTime = Measure(POINT_COUNT, [&]
+			{
+				worldViewProjection.TransformPoints(points, points4);
+			});
+
+		float maxDifference{ 0.f };
+		for (size_t i{ 0 }; i < POINT_COUNT; ++i) maxDifference = std::max(maxDifference, MaxDifference(scalarPoints4[i], points4[i]));
+		PrintResult("TransformPoints (batched)", scalarTime, currentTime, maxDifference);
+	}
+
+	// Matrix concatenation, chained so every product depends on the previous one
+	{
+		constexpr size_t MULTIPLY_COUNT{ 4096 };
+		const Matrix step{ Matrix::CreateRotation(1e-3f, 2e-3f, 3e-3f) };
+
+		Matrix scalarProduct{}, product{};
+		const double scalarTime = Measure(MULTIPLY_COUNT, [&]
+			{
+				scalarProduct = Matrix{};
+				for (size_t i{ 0 }; i < MULTIPLY_COUNT; ++i) scalarProduct = scalar::Multiply(scalarProduct, step);
+			});
+		const double currentTime = Measure(MULTIPLY_COUNT, [&]
+			{
+				product = Matrix{};
+				for (size_t i{ 0 }; i < MULTIPLY_COUNT; ++i) product *= step;
+			});
+
+		float maxDifference{ 0.f };
+		for (int r{ 0 }; r < 4; ++r) maxDifference = std::max(maxDifference, MaxDifference(scalarProduct[r], product[r]));
+		PrintResult("Matrix * Matrix", scalarTime, currentTime, maxDifference);
+	}
+
+	return 0;
+}
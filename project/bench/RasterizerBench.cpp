@@ -0,0 +1,551 @@
+// Benchmarks the math, sampling and raster kernels and a full frame.
+// Usage: rasterizer_bench [--filter=<substring>] [--min-time=<seconds>] [--json=<file>] [--baseline=<file>]
+// Run from the directory holding resources/, the JSON follows Google Benchmark's layout so its compare tools can read it.
+// --baseline reads the JSON of an earlier run and adds the speedup against it, with the geometric mean at the end.
+// Render benchmarks measure throughput as the time per frame and report the latency of each frame on its own,
+// the two differ once frames are pipelined.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Maths.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Texture.h"
+#include "Timer.h"
+#include "Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	struct Benchmark
+	{
+		std::string name;
+		// Runs the kernel the given number of times
+		std::function<void(int64_t)> run;
+		// Work per iteration for the items/s column, points, samples or pixels
+		int64_t itemsPerIteration{ 1 };
+		// Runs once before timing, outside the measurement
+		std::function<void()> setup{};
+		// Average frame latency of the last run in nanoseconds, for the render benchmarks
+		std::function<double()> latency{};
+	};
+
+	struct Result
+	{
+		std::string name;
+		int64_t iterations{};
+		double nanosecondsPerIteration{};
+		double itemsPerSecond{};
+		double latencyNanoseconds{};
+	};
+
+	// Keeps the compiler from discarding results that are otherwise unused
+	volatile float g_Sink{};
+
+	// Renderer state every render benchmark starts from, each case changes only the setting it measures
+	struct RenderSettings
+	{
+		bool isPipelined{};
+		DepthFormat depthFormat{ DepthFormat::D32F };
+		float renderScale{ 1.f };
+		Renderer::ShadingRate shadingRate{ Renderer::ShadingRate::Full };
+		Renderer::RenderPath renderPath{ Renderer::RenderPath::Forward };
+		bool isMsaa{};
+		bool isReprojectionCache{};
+	};
+
+	// Loads the scene unless it is already shown and applies every setting, so no case inherits one from the case before
+	void ConfigureRender(Renderer& renderer, Timer& timer, Renderer::SceneType scene, const RenderSettings& settings)
+	{
+		if (renderer.GetScene() != scene) renderer.SetScene(scene);
+		renderer.SetIsPipelined(settings.isPipelined);
+		renderer.SetDepthFormat(settings.depthFormat);
+		renderer.SetRenderScale(settings.renderScale);
+		renderer.SetShadingRate(settings.shadingRate);
+		renderer.SetRenderPath(settings.renderPath);
+		renderer.SetIsMsaa(settings.isMsaa);
+		renderer.SetIsReprojectionCache(settings.isReprojectionCache);
+		renderer.Update(&timer);
+	}
+
+	double TimeIterations(const Benchmark& benchmark, int64_t iterations)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		benchmark.run(iterations);
+		const auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(end - start).count();
+	}
+
+	// Grows the iteration count until a run takes minTime, then keeps the fastest of three runs
+	Result RunBenchmark(const Benchmark& benchmark, double minTime)
+	{
+		constexpr int REPETITIONS{ 3 };
+
+		int64_t iterations{ 1 };
+		double seconds{ TimeIterations(benchmark, iterations) };
+		while (seconds < minTime && iterations < (int64_t{ 1 } << 40))
+		{
+			const double scale{ seconds > 0. ? std::min(10., 1.4 * minTime / seconds) : 10. };
+			iterations = std::max(iterations + 1, static_cast<int64_t>(static_cast<double>(iterations) * scale));
+			seconds = TimeIterations(benchmark, iterations);
+		}
+
+		for (int repetition{ 1 }; repetition < REPETITIONS; ++repetition)
+		{
+			seconds = std::min(seconds, TimeIterations(benchmark, iterations));
+		}
+
+		Result result{ benchmark.name, iterations };
+		result.nanosecondsPerIteration = seconds * 1e9 / static_cast<double>(iterations);
+		result.itemsPerSecond = static_cast<double>(benchmark.itemsPerIteration) * static_cast<double>(iterations) / seconds;
+		if (benchmark.latency) result.latencyNanoseconds = benchmark.latency();
+		return result;
+	}
+
+	void WriteJson(const std::string& path, const std::vector<Result>& results)
+	{
+		std::ofstream file{ path };
+		if (!file)
+		{
+			std::cerr << "Could not write " << path << std::endl;
+			return;
+		}
+
+		file << "{\n"
+			<< "  \"context\": {\n"
+			<< "    \"executable\": \"rasterizer_bench\",\n"
+			<< "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+			<< "    \"simd_level\": " << DAE_SIMD_LEVEL << "\n"
+			<< "  },\n"
+			<< "  \"benchmarks\": [\n";
+		for (size_t i{ 0 }; i < results.size(); ++i)
+		{
+			const Result& result{ results[i] };
+			file << "    {\n"
+				<< "      \"name\": \"" << result.name << "\",\n"
+				<< "      \"run_type\": \"iteration\",\n"
+				<< "      \"iterations\": " << result.iterations << ",\n"
+				<< "      \"real_time\": " << std::setprecision(9) << result.nanosecondsPerIteration << ",\n"
+				<< "      \"cpu_time\": " << result.nanosecondsPerIteration << ",\n"
+				<< "      \"time_unit\": \"ns\",\n"
+				<< "      \"items_per_second\": " << result.itemsPerSecond;
+			if (result.latencyNanoseconds > 0.) file << ",\n      \"latency_ns\": " << result.latencyNanoseconds;
+			file << "\n"
+				<< "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		file << "  ]\n}\n";
+	}
+
+	// Reads the name and real_time pairs back from a file written by WriteJson
+	std::map<std::string, double> ReadJson(const std::string& path)
+	{
+		std::map<std::string, double> times{};
+		std::ifstream file{ path };
+		std::string line{}, name{};
+		while (std::getline(file, line))
+		{
+			const size_t colon{ line.find(':') };
+			if (colon == std::string::npos) continue;
+
+			if (line.find("\"name\"") != std::string::npos)
+			{
+				const size_t begin{ line.find('"', colon) + 1 };
+				name = line.substr(begin, line.rfind('"') - begin);
+			}
+			else if (line.find("\"real_time\"") != std::string::npos && !name.empty())
+			{
+				times[name] = std::stod(line.substr(colon + 1));
+			}
+		}
+		return times;
+	}
+
+	// Screen space triangle in the layout RasterizeTriangle expects: x and y in [0, 1], z in [0, 1], w the view depth
+	void MakeScreenTriangle(int size, int width, int height, float z, Vertex_Out vertices[3])
+	{
+		const float centerX{ width * .5f }, centerY{ height * .5f }, half{ size * .5f };
+		const Vector2 corners[3]{ { centerX, centerY - half }, { centerX + half, centerY + half }, { centerX - half, centerY + half } };
+		const Vector2 uvs[3]{ { .5f, 0.f }, { 1.f, 1.f }, { 0.f, 1.f } };
+
+		for (int corner{ 0 }; corner < 3; ++corner)
+		{
+			vertices[corner].position = { corners[corner].x / width, corners[corner].y / height, z, 10.f };
+			vertices[corner].uv = uvs[corner];
+			vertices[corner].normal = { 0.f, 0.f, -1.f };
+			vertices[corner].tangent = { 1.f, 0.f, 0.f };
+			vertices[corner].viewDirection = { 0.f, 0.f, 1.f };
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string filter{};
+	std::string jsonPath{};
+	std::string baselinePath{};
+	double minTime{ .5 };
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ argv[i] };
+		if (argument.rfind("--filter=", 0) == 0) filter = argument.substr(9);
+		else if (argument.rfind("--json=", 0) == 0) jsonPath = argument.substr(7);
+		else if (argument.rfind("--baseline=", 0) == 0) baselinePath = argument.substr(11);
+		else if (argument.rfind("--min-time=", 0) == 0) minTime = std::stod(argument.substr(11));
+		else
+		{
+			std::cout << "Usage: rasterizer_bench [--filter=<substring>] [--min-time=<seconds>] [--json=<file>] [--baseline=<file>]" << std::endl;
+			return 1;
+		}
+	}
+
+	constexpr int64_t BATCH_SIZE{ 4096 };
+	std::mt19937 random{ 1234 };
+	std::uniform_real_distribution<float> distribution{ 0.f, 1.f };
+
+	std::vector<Vector3> points(BATCH_SIZE);
+	std::vector<Vector2> uvs(BATCH_SIZE);
+	std::vector<Vector3> weights(BATCH_SIZE);
+	for (int64_t i{ 0 }; i < BATCH_SIZE; ++i)
+	{
+		points[i] = { distribution(random) * 40.f - 20.f, distribution(random) * 20.f - 10.f, distribution(random) * 40.f - 20.f };
+		uvs[i] = { distribution(random), distribution(random) };
+		const float w0{ distribution(random) }, w1{ distribution(random) * (1.f - w0) };
+		weights[i] = { w0, w1, 1.f - w0 - w1 };
+	}
+
+	std::vector<Benchmark> benchmarks{};
+
+	// Math
+	const Matrix worldViewProjection{ Matrix::CreateRotationY(.5f) * Matrix::CreateLookAtLH({ 0.f, 5.f, -64.f }, Vector3::UnitZ, Vector3::UnitY)
+		* Matrix::CreatePerspectiveFovLH(std::tan(45.f * TO_RADIANS * .5f), 4.f / 3.f, .1f, 100.f) };
+	benchmarks.push_back({ "Matrix::TransformPoint", [&](int64_t iterations)
+		{
+			float sum{};
+			for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+			{
+				for (const Vector3& point : points) sum += worldViewProjection.TransformPoint(Vector4{ point, 1.f }).w;
+			}
+			g_Sink = sum;
+		}, BATCH_SIZE });
+
+	benchmarks.push_back({ "Vector3::Interpolate", [&](int64_t iterations)
+		{
+			const Vector3 a{ 1.f, 0.f, 0.f }, b{ 0.f, 1.f, 0.f }, c{ 0.f, 0.f, 1.f };
+			float sum{};
+			for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+			{
+				for (const Vector3& weight : weights)
+				{
+					const float interpolatedDepth{ 1.f / (weight.x / 2.f + weight.y / 3.f + weight.z / 4.f) };
+					sum += Vector3::Interpolate(a, b, c, 2.f, 3.f, 4.f, weight.x, weight.y, weight.z, interpolatedDepth, 24.f).x;
+				}
+			}
+			g_Sink = sum;
+		}, BATCH_SIZE });
+
+	// Sampling
+	std::unique_ptr<Texture> pTexture{ Texture::LoadFromFile("resources/vehicle_diffuse.png") };
+	if (pTexture)
+	{
+		benchmarks.push_back({ "Texture::Sample", [&](int64_t iterations)
+			{
+				float sum{};
+				for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+				{
+					for (const Vector2& uv : uvs) sum += pTexture->Sample(uv).g;
+				}
+				g_Sink = sum;
+			}, BATCH_SIZE });
+	}
+
+	// Loading
+	std::vector<std::string> objPaths{};
+	std::error_code error{};
+	for (const auto& entry : std::filesystem::directory_iterator{ "resources", error })
+	{
+		if (entry.path().extension() == ".obj") objPaths.push_back(entry.path().generic_string());
+	}
+	std::sort(objPaths.begin(), objPaths.end());
+	for (const std::string& path : objPaths)
+	{
+		benchmarks.push_back({ "ParseOBJ/" + std::filesystem::path{ path }.filename().string(), [path](int64_t iterations)
+			{
+				std::vector<Vertex> vertices{};
+				std::vector<uint32_t> indices{};
+				for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+				{
+					vertices.clear();
+					indices.clear();
+					Utils::ParseOBJ(path, vertices, indices);
+				}
+				g_Sink = static_cast<float>(indices.size());
+			} });
+	}
+
+	// Rasterization, the renderer starts with the vehicle scene
+	constexpr int WIDTH{ 640 };
+	constexpr int HEIGHT{ 480 };
+	Renderer renderer{ WIDTH, HEIGHT };
+	Timer timer{};
+	timer.Start();
+	timer.Update();
+	renderer.SetIsRotating(false);
+	// Timed frames render the same view over and over
+	renderer.SetIsFrameSkipping(false);
+	renderer.Update(&timer);
+
+	Material triangleMaterial{};
+	std::unique_ptr<Texture> pNormal{ Texture::LoadFromFile("resources/vehicle_normal.png") };
+	std::unique_ptr<Texture> pGloss{ Texture::LoadFromFile("resources/vehicle_gloss.png") };
+	std::unique_ptr<Texture> pSpecular{ Texture::LoadFromFile("resources/vehicle_specular.png") };
+	triangleMaterial = { pTexture.get(), pNormal.get(), pGloss.get(), pSpecular.get() };
+
+	for (const int size : { 4, 16, 64, 256 })
+	{
+		benchmarks.push_back({ "RasterizeTriangle/" + std::to_string(size), [&, size](int64_t iterations)
+			{
+				// Every copy is slightly nearer than the last so it passes the depth test without clearing in between
+				constexpr float NEAREST{ .5f };
+				constexpr float DEPTH_STEP{ 1e-6f };
+				float z{ 1.f };
+				int pixelsShaded{}, fragmentsRejected{};
+				Vertex_Out vertices[3]{};
+				renderer.ClearBuffers();
+				for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+				{
+					z -= DEPTH_STEP;
+					if (z < NEAREST)
+					{
+						renderer.ClearBuffers();
+						z = 1.f - DEPTH_STEP;
+					}
+					MakeScreenTriangle(size, WIDTH, HEIGHT, z, vertices);
+					renderer.RasterizeTriangle(vertices[0], vertices[1], vertices[2], triangleMaterial, pixelsShaded, fragmentsRejected);
+				}
+				g_Sink = static_cast<float>(pixelsShaded);
+			}, int64_t{ size } * size / 2 });
+	}
+
+	// Upscale of a frame rendered at a share of the window's resolution
+	std::vector<uint32_t> scaledPixels(static_cast<size_t>(WIDTH) * HEIGHT);
+	std::generate(scaledPixels.begin(), scaledPixels.end(), [&] { return static_cast<uint32_t>(random()) & 0xFFFFFF; });
+	std::vector<uint32_t> upscaledPixels(scaledPixels.size());
+	std::vector<int16_t> upscaleRow(4 * (static_cast<size_t>(WIDTH) + 1));
+	for (const int percent : { 50, 75 })
+	{
+		benchmarks.push_back({ "Framebuffer::Upscale/" + std::to_string(percent), [&, percent](int64_t iterations)
+			{
+				for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+				{
+					Framebuffer::Upscale(scaledPixels.data(), WIDTH * percent / 100, HEIGHT * percent / 100, upscaledPixels.data(), WIDTH, HEIGHT, WIDTH,
+						0, HEIGHT, upscaleRow.data());
+				}
+				g_Sink = static_cast<float>(upscaledPixels[0]);
+			}, int64_t{ WIDTH } * HEIGHT });
+	}
+
+	// Twice the width and height for 4x supersampling, created by the first benchmark that needs it
+	std::unique_ptr<Renderer> pSupersampled{};
+	bool isAntialiased{};
+
+	const std::pair<Renderer::SceneType, const char*> scenes[]{
+		{ Renderer::SceneType::Vehicle, "vehicle" },
+		{ Renderer::SceneType::VehicleGrid, "vehicle_grid" },
+		{ Renderer::SceneType::JinxCrowd, "jinx_crowd" },
+		{ Renderer::SceneType::ParkingLot, "parking_lot" }
+	};
+	for (const auto& [scene, sceneName] : scenes)
+	{
+		for (const bool isPipelined : { false, true })
+		{
+			const auto pLatency{ std::make_shared<double>() };
+			benchmarks.push_back({ std::string{ "Render/" } + sceneName + (isPipelined ? "/pipelined" : ""), [&, pLatency](int64_t iterations)
+				{
+					int64_t latencySum{};
+					for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+					{
+						renderer.Render();
+						latencySum += renderer.GetFrameStats().latencyNanoseconds;
+					}
+					*pLatency = static_cast<double>(latencySum) / static_cast<double>(iterations);
+				}, int64_t{ WIDTH } * HEIGHT, [&, scene, isPipelined]
+				{
+					ConfigureRender(renderer, timer, scene, { .isPipelined = isPipelined });
+					// Fills the pipeline, so every timed frame overlaps the next one's geometry
+					renderer.Render();
+				}, [pLatency] { return *pLatency; } });
+		}
+
+		// Compact depth formats, sequential so only the depth traffic differs from the plain case
+		for (const auto& [depthFormat, formatName] : { std::pair{ DepthFormat::D16, "d16" }, std::pair{ DepthFormat::D24, "d24" } })
+		{
+			benchmarks.push_back({ std::string{ "Render/" } + sceneName + "/" + formatName, [&](int64_t iterations)
+				{
+					for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+					{
+						renderer.Render();
+					}
+				}, int64_t{ WIDTH } * HEIGHT, [&, scene, depthFormat]
+				{
+					ConfigureRender(renderer, timer, scene, { .depthFormat = depthFormat });
+				} });
+		}
+
+		// Below the window's resolution and upscaled, what dynamic resolution trades for frame time
+		for (const int percent : { 50, 75 })
+		{
+			benchmarks.push_back({ std::string{ "Render/" } + sceneName + "/scale" + std::to_string(percent), [&](int64_t iterations)
+				{
+					for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+					{
+						renderer.Render();
+					}
+				}, int64_t{ WIDTH } * HEIGHT, [&, scene, percent]
+				{
+					ConfigureRender(renderer, timer, scene, { .renderScale = percent / 100.f });
+				} });
+		}
+
+		// Coarse shading, the adaptive rate settles on the first frames of the same view
+		for (const auto& [shadingRate, rateName] : { std::pair{ Renderer::ShadingRate::Coarse2x2, "shading2x2" },
+			std::pair{ Renderer::ShadingRate::Coarse4x4, "shading4x4" }, std::pair{ Renderer::ShadingRate::Adaptive, "shading_adaptive" } })
+		{
+			benchmarks.push_back({ std::string{ "Render/" } + sceneName + "/" + rateName, [&](int64_t iterations)
+				{
+					for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+					{
+						renderer.Render();
+					}
+				}, int64_t{ WIDTH } * HEIGHT, [&, scene, shadingRate]
+				{
+					ConfigureRender(renderer, timer, scene, { .shadingRate = shadingRate });
+					renderer.Render();
+				} });
+		}
+
+		// The visibility buffer path with the instances turning a little every frame, shading everything or reusing last frame's colors
+		for (const bool isReprojectionCache : { false, true })
+		{
+			benchmarks.push_back({ std::string{ "Render/" } + sceneName + (isReprojectionCache ? "/reprojection_cache" : "/visibility"), [&](int64_t iterations)
+				{
+					for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+					{
+						renderer.SetRotation(static_cast<float>(iteration % 360) * TO_RADIANS);
+						renderer.Render();
+					}
+					// Back to the orientation every other case renders
+					renderer.SetRotation(0.f);
+				}, int64_t{ WIDTH } * HEIGHT, [&, scene, isReprojectionCache]
+				{
+					ConfigureRender(renderer, timer, scene,
+						{ .renderPath = Renderer::RenderPath::VisibilityBuffer, .isReprojectionCache = isReprojectionCache });
+					renderer.SetRotation(0.f);
+					renderer.Render();
+				} });
+		}
+
+		// 4x antialiasing, multisampled at the window's resolution or supersampled at twice its width and height.
+		// The supersampled frame is not filtered down, that pass is small next to rendering four times the pixels.
+		benchmarks.push_back({ std::string{ "Render/" } + sceneName + "/msaa4x", [&](int64_t iterations)
+			{
+				for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+				{
+					renderer.Render();
+				}
+			}, int64_t{ WIDTH } * HEIGHT, [&, scene]
+			{
+				ConfigureRender(renderer, timer, scene, { .isMsaa = true });
+				isAntialiased = true;
+			} });
+		benchmarks.push_back({ std::string{ "Render/" } + sceneName + "/ssaa4x", [&](int64_t iterations)
+			{
+				for (int64_t iteration{ 0 }; iteration < iterations; ++iteration)
+				{
+					pSupersampled->Render();
+				}
+			}, int64_t{ WIDTH } * HEIGHT, [&, scene]
+			{
+				if (!pSupersampled)
+				{
+					pSupersampled = std::make_unique<Renderer>(WIDTH * 2, HEIGHT * 2);
+					pSupersampled->SetIsRotating(false);
+					pSupersampled->SetIsFrameSkipping(false);
+				}
+				ConfigureRender(*pSupersampled, timer, scene, {});
+				isAntialiased = true;
+			} });
+	}
+
+	// Run
+	const std::map<std::string, double> baseline{ baselinePath.empty() ? std::map<std::string, double>{} : ReadJson(baselinePath) };
+	if (!baselinePath.empty() && baseline.empty()) std::cerr << "Could not read " << baselinePath << std::endl;
+
+	std::vector<Result> results{};
+	double logSpeedupSum{};
+	int speedupCount{};
+	std::cout << std::left << std::setw(36) << "Benchmark" << std::right << std::setw(16) << "Time" << std::setw(14) << "Iterations"
+		<< std::setw(16) << "Items/s" << std::setw(14) << "Latency" << (baseline.empty() ? "" : "     Speedup") << std::endl;
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) continue;
+
+		if (benchmark.setup) benchmark.setup();
+		const Result result{ RunBenchmark(benchmark, minTime) };
+		results.push_back(result);
+		std::cout << std::left << std::setw(36) << result.name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(13) << result.nanosecondsPerIteration << " ns" << std::setw(14) << result.iterations;
+		std::cout << std::setw(16);
+		if (benchmark.itemsPerIteration > 1) std::cout << std::setprecision(3) << result.itemsPerSecond / 1e6 << "M";
+		else std::cout << "";
+		if (benchmark.latency) std::cout << std::setw(11) << std::setprecision(3) << result.latencyNanoseconds / 1e6 << " ms";
+		else std::cout << std::setw(14) << "";
+
+		const auto baselineTime{ baseline.find(result.name) };
+		if (baselineTime != baseline.end())
+		{
+			const double speedup{ baselineTime->second / result.nanosecondsPerIteration };
+			logSpeedupSum += std::log(speedup);
+			++speedupCount;
+			std::cout << std::setw(11) << std::setprecision(3) << speedup << "x";
+		}
+		std::cout << std::endl;
+	}
+	if (speedupCount > 0)
+	{
+		std::cout << "Geometric mean speedup over " << baselinePath << ": " << std::setprecision(3)
+			<< std::exp(logSpeedupSum / speedupCount) << "x over " << speedupCount << " benchmark(s)" << std::endl;
+	}
+
+	// The memory side of the antialiasing benchmarks
+	if (isAntialiased)
+	{
+		constexpr float BYTES_PER_MB{ 1024.f * 1024.f };
+		renderer.SetIsMsaa(false);
+		const size_t singleSampleBytes{ renderer.GetRenderTargetBytes() };
+		renderer.SetIsMsaa(true);
+		const size_t multisampledBytes{ renderer.GetRenderTargetBytes() };
+		renderer.SetIsMsaa(false);
+		std::cout << "Render targets at " << WIDTH << "x" << HEIGHT << ": " << std::setprecision(1) << singleSampleBytes / BYTES_PER_MB << " MB at 1x, "
+			<< multisampledBytes / BYTES_PER_MB << " MB with MSAA 4x";
+		if (pSupersampled) std::cout << ", " << pSupersampled->GetRenderTargetBytes() / BYTES_PER_MB << " MB with SSAA 4x";
+		std::cout << std::endl;
+	}
+
+	if (!jsonPath.empty()) WriteJson(jsonPath, results);
+	return 0;
+}
@@ -0,0 +1,52 @@
+#include "ScalarMath.h"
+
+namespace dae::scalar
+{
+	Vector3 TransformVector(const Matrix& m, const Vector3& v)
+	{
+		const Vector4 r0{ m[0] }, r1{ m[1] }, r2{ m[2] };
+		return Vector3{
+			r0.x * v.x + r1.x * v.y + r2.x * v.z,
+			r0.y * v.x + r1.y * v.y + r2.y * v.z,
+			r0.z * v.x + r1.z * v.y + r2.z * v.z
+		};
+	}
+
+	Vector3 TransformPoint(const Matrix& m, const Vector3& p)
+	{
+		const Vector4 r0{ m[0] }, r1{ m[1] }, r2{ m[2] }, r3{ m[3] };
+		return Vector3{
+			r0.x * p.x + r1.x * p.y + r2.x * p.z + r3.x,
+			r0.y * p.x + r1.y * p.y + r2.y * p.z + r3.y,
+			r0.z * p.x + r1.z * p.y + r2.z * p.z + r3.z
+		};
+	}
+
+	Vector4 TransformPoint(const Matrix& m, const Vector4& p)
+	{
+		const Vector4 r0{ m[0] }, r1{ m[1] }, r2{ m[2] }, r3{ m[3] };
+		return Vector4{
+			r0.x * p.x + r1.x * p.y + r2.x * p.z + r3.x,
+			r0.y * p.x + r1.y * p.y + r2.y * p.z + r3.y,
+			r0.z * p.x + r1.z * p.y + r2.z * p.z + r3.z,
+			r0.w * p.x + r1.w * p.y + r2.w * p.z + r3.w
+		};
+	}
+
+	Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix result{};
+		const Matrix bTransposed{ Matrix::Transpose(b) };
+
+		for (int r{ 0 }; r < 4; ++r)
+		{
+			for (int c{ 0 }; c < 4; ++c)
+			{
+				const Vector4 row{ a[r] }, column{ bTransposed[c] };
+				result[r][c] = row.x * column.x + row.y * column.y + row.z * column.z + row.w * column.w;
+			}
+		}
+
+		return result;
+	}
+}
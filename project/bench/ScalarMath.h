@@ -0,0 +1,12 @@
+#pragma once
+#include "Matrix.h"
+
+namespace dae::scalar
+{
+	// The out-of-line scalar transforms the math back end replaced, kept in their own translation unit
+	// so the benchmark measures them the way the renderer used to call them
+	Vector3 TransformVector(const Matrix& m, const Vector3& v);
+	Vector3 TransformPoint(const Matrix& m, const Vector3& p);
+	Vector4 TransformPoint(const Matrix& m, const Vector4& p);
+	Matrix Multiply(const Matrix& a, const Matrix& b);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <cassert>
 #include <iostream>
+#include <limits>
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
 #include "Maths.h"
@@ -27,6 +28,12 @@ namespace dae
 		Vector3 origin{};
 		float fovAngle{ 90.f };
 		float fov{ tanf((fovAngle * TO_RADIANS) / 2.f) };
+		float nearPlane{ .1f };
+		float farPlane{ 100.f };
+		// Depth 1 at the near plane and 0 at the far one
+		bool isReversedZ{};
+		// Nothing is clipped by distance, farPlane only remains the range draws are sorted over
+		bool isInfiniteFar{};
 
 		Vector3 forward{ Vector3::UnitZ };
 		Vector3 up{ Vector3::UnitY };
@@ -63,7 +70,10 @@ namespace dae
 		{
 			if (isProjectionMatrixDirty)
 			{
-				projectionMatrix = Matrix::CreatePerspectiveFovLH(fov, width / height, .1f, 100.f);
+				const float projectionFar = isInfiniteFar ? std::numeric_limits<float>::infinity() : farPlane;
+				projectionMatrix = isReversedZ
+					? Matrix::CreateReversedPerspectiveFovLH(fov, width / height, nearPlane, projectionFar)
+					: Matrix::CreatePerspectiveFovLH(fov, width / height, nearPlane, projectionFar);
 				isProjectionMatrixDirty = false; // Reset flag after update
 			}
 		}
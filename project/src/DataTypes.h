@@ -1,6 +1,7 @@
 #pragma once
 #include "Maths.h"
 #include "vector"
+#include <algorithm>
 
 namespace dae
 {
@@ -24,6 +25,73 @@ namespace dae
 		Vector3 viewDirection{};
 	};
 
+	struct BoundingBox
+	{
+		Vector3 min{};
+		Vector3 max{};
+
+		// Axis-aligned box around the transformed box (Arvo)
+		BoundingBox Transformed(const Matrix& matrix) const
+		{
+			BoundingBox box{ matrix.GetTranslation(), matrix.GetTranslation() };
+			for (int row{ 0 }; row < 3; ++row)
+			{
+				for (int column{ 0 }; column < 3; ++column)
+				{
+					const float a = matrix[row][column] * min[row];
+					const float b = matrix[row][column] * max[row];
+					box.min[column] += std::min(a, b);
+					box.max[column] += std::max(a, b);
+				}
+			}
+			return box;
+		}
+	};
+
+	struct BoundingSphere
+	{
+		Vector3 center{};
+		float radius{};
+
+		BoundingSphere Transformed(const Matrix& matrix) const
+		{
+			const float scale = std::max({ matrix.GetAxisX().Magnitude(), matrix.GetAxisY().Magnitude(), matrix.GetAxisZ().Magnitude() });
+			return { matrix.TransformPoint(center), radius * scale };
+		}
+	};
+
+	// Local vertex indices are stored as uint8_t, 0xFF marks an unassigned vertex while building
+	constexpr uint32_t MAX_MESHLET_VERTICES{ 254 };
+	constexpr uint32_t MAX_MESHLET_TRIANGLES{ 128 };
+
+	struct Meshlet
+	{
+		uint32_t vertexOffset{}; // into MeshLod::meshletVertices
+		uint32_t vertexCount{};
+		uint32_t triangleOffset{}; // into MeshLod::meshletTriangles, 3 local indices per triangle
+		uint32_t triangleCount{};
+
+		BoundingSphere boundingSphere{};
+
+		// Normal cone, every triangle faces away from an eye inside the cone behind the meshlet
+		Vector3 coneAxis{};
+		float coneCutoff{ 1.f };
+	};
+
+	constexpr size_t MAX_MESH_LODS{ 4 };
+
+	// One level of detail, a triangle list over the vertices of its Mesh
+	struct MeshLod
+	{
+		std::vector<uint32_t> indices{};
+		float error{}; // object space deviation from the full detail mesh
+
+		// Clusters of triangles, filled in by Utils::BuildMeshlets
+		std::vector<Meshlet> meshlets{};
+		std::vector<uint32_t> meshletVertices{};
+		std::vector<uint8_t> meshletTriangles{};
+	};
+
 	enum class PrimitiveTopology
 	{
 		TriangleList,
@@ -36,7 +104,30 @@ namespace dae
 		std::vector<uint32_t> indices{};
 		PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleStrip };
 
-		std::vector<Vertex_Out> vertices_out{};
-		Matrix worldMatrix{};
+		// lods[0] is the full detail mesh, every next level has roughly half the triangles
+		std::vector<MeshLod> lods{};
+
+		// Object space bounds, filled in by CalculateBounds after loading
+		BoundingBox boundingBox{};
+		BoundingSphere boundingSphere{};
+
+		void CalculateBounds()
+		{
+			if (vertices.empty()) return;
+
+			boundingBox.min = boundingBox.max = vertices[0].position;
+			for (const Vertex& vertex : vertices)
+			{
+				boundingBox.min = { std::min(boundingBox.min.x, vertex.position.x), std::min(boundingBox.min.y, vertex.position.y), std::min(boundingBox.min.z, vertex.position.z) };
+				boundingBox.max = { std::max(boundingBox.max.x, vertex.position.x), std::max(boundingBox.max.y, vertex.position.y), std::max(boundingBox.max.z, vertex.position.z) };
+			}
+
+			boundingSphere.center = (boundingBox.min + boundingBox.max) * 0.5f;
+			boundingSphere.radius = 0.f;
+			for (const Vertex& vertex : vertices)
+			{
+				boundingSphere.radius = std::max(boundingSphere.radius, (vertex.position - boundingSphere.center).Magnitude());
+			}
+		}
 	};
 }
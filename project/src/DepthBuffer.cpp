@@ -0,0 +1,87 @@
+#include "DepthBuffer.h"
+
+#include <algorithm>
+#include <limits>
+#include "StreamStore.h"
+
+namespace dae
+{
+	DepthBuffer::DepthBuffer(int width, int height, DepthFormat format, bool isReversedZ) :
+		m_Width(width),
+		m_Height(height),
+		m_Format(format),
+		m_IsReversedZ(isReversedZ)
+	{
+		VisitFormat([&](auto depthFormat)
+			{
+				using Format = decltype(depthFormat);
+				m_Texels.resize(static_cast<size_t>(width) * height * sizeof(typename Format::Texel));
+			});
+		Clear(0, 0, width, height, false);
+	}
+
+	void DepthBuffer::Clear(int x, int y, int width, int height, bool isStreamed)
+	{
+		VisitFormat([&](auto depthFormat)
+			{
+				using Format = decltype(depthFormat);
+				typename Format::Texel* pTexels = GetTexels<Format>();
+				if (isStreamed)
+				{
+					StreamFill(pTexels, m_Width, x, y, width, height, Format::CLEAR_TEXEL);
+					return;
+				}
+				for (int row = y; row < y + height; ++row)
+				{
+					std::fill_n(&pTexels[static_cast<size_t>(row) * m_Width + x], width, Format::CLEAR_TEXEL);
+				}
+			});
+	}
+
+	float DepthBuffer::GetFarthest(int x, int y, int width, int height) const
+	{
+		return VisitFormat([&](auto depthFormat)
+			{
+				// Compared as texels, only the farthest one is decoded
+				using Format = decltype(depthFormat);
+				const typename Format::Texel* pTexels = GetTexels<Format>();
+				typename Format::Texel farthest{ 0 };
+				for (int row = y; row < y + height; ++row)
+				{
+					const typename Format::Texel* pRow = &pTexels[static_cast<size_t>(row) * m_Width + x];
+					farthest = std::max(farthest, *std::max_element(pRow, pRow + width));
+				}
+
+				if (farthest >= Format::CLEAR_TEXEL) return std::numeric_limits<float>::max();
+				return Format::Decode(static_cast<typename Format::Texel>(farthest + 1));
+			});
+	}
+
+	void DepthBuffer::ResolveSamples(const DepthBuffer& samples, int sampleCount, int x, int y, int width, int height)
+	{
+		VisitFormat([&](auto depthFormat)
+			{
+				using Format = decltype(depthFormat);
+				const typename Format::Texel* pSamples = samples.GetTexels<Format>();
+				typename Format::Texel* pTexels = GetTexels<Format>();
+				for (int row = y; row < y + height; ++row)
+				{
+					for (int column = x; column < x + width; ++column)
+					{
+						const size_t pixelIndex = static_cast<size_t>(row) * m_Width + column;
+						const typename Format::Texel* pPixelSamples = &pSamples[pixelIndex * sampleCount];
+						pTexels[pixelIndex] = *std::max_element(pPixelSamples, pPixelSamples + sampleCount);
+					}
+				}
+			});
+	}
+
+	float DepthBuffer::GetDepth(int x, int y) const
+	{
+		return VisitFormat([&](auto depthFormat)
+			{
+				using Format = decltype(depthFormat);
+				return Format::Decode(GetTexels<Format>()[static_cast<size_t>(y) * m_Width + x]);
+			});
+	}
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dae
+{
+	enum class DepthFormat
+	{
+		// 16-bit unsigned normalized, half the memory and bandwidth of the others
+		D16,
+		// 24-bit unsigned normalized in a 32-bit texel, the top byte is unused since there is no stencil
+		D24,
+		// The float depth itself
+		D32F
+	};
+
+	// Every format stores depth in [0, 1] as an unsigned texel that is smaller the nearer the depth it encodes,
+	// so the depth test and the step nearer the depth prepass claims pixels with are the same integer operations for all of them.
+	struct DepthD16
+	{
+		using Texel = uint16_t;
+		static constexpr Texel CLEAR_TEXEL{ 0xFFFF };
+		static Texel Encode(float depth)
+		{
+			return static_cast<Texel>(depth * 65535.f + .5f);
+		}
+		static float Decode(Texel texel)
+		{
+			return texel / 65535.f;
+		}
+	};
+
+	struct DepthD24
+	{
+		using Texel = uint32_t;
+		static constexpr Texel CLEAR_TEXEL{ 0xFFFFFF };
+		static Texel Encode(float depth)
+		{
+			return static_cast<Texel>(depth * 16777215.f + .5f);
+		}
+		static float Decode(Texel texel)
+		{
+			return texel / 16777215.f;
+		}
+	};
+
+	struct DepthD32F
+	{
+		// Positive floats order like their bit patterns
+		using Texel = uint32_t;
+		// The largest finite float, farther than any depth
+		static constexpr Texel CLEAR_TEXEL{ 0x7F7FFFFF };
+		static Texel Encode(float depth)
+		{
+			return std::bit_cast<Texel>(depth);
+		}
+		static float Decode(Texel texel)
+		{
+			return std::bit_cast<float>(texel);
+		}
+	};
+
+	// Reversed-Z depth, 1 at the near plane and 0 at the far one, mirrored into the texel range so nearer still means smaller
+	template<typename Format>
+	struct ReversedDepth
+	{
+		using Texel = typename Format::Texel;
+		static constexpr Texel CLEAR_TEXEL{ Format::CLEAR_TEXEL };
+		static Texel Encode(float depth)
+		{
+			return static_cast<Texel>(CLEAR_TEXEL - Format::Encode(depth));
+		}
+		static float Decode(Texel texel)
+		{
+			return Format::Decode(static_cast<Texel>(CLEAR_TEXEL - texel));
+		}
+	};
+
+	// Calls visitor with the format struct matching depthFormat and the depth direction, so pixel loops are compiled once per format
+	template<typename Visitor>
+	decltype(auto) VisitDepthFormat(DepthFormat depthFormat, bool isReversedZ, Visitor&& visitor)
+	{
+		switch (depthFormat)
+		{
+		case DepthFormat::D16:
+			if (isReversedZ) return visitor(ReversedDepth<DepthD16>{});
+			return visitor(DepthD16{});
+		case DepthFormat::D24:
+			if (isReversedZ) return visitor(ReversedDepth<DepthD24>{});
+			return visitor(DepthD24{});
+		default:
+			if (isReversedZ) return visitor(ReversedDepth<DepthD32F>{});
+			return visitor(DepthD32F{});
+		}
+	}
+
+	// Full resolution depth in one of the formats above, cleared on creation
+	class DepthBuffer final
+	{
+	public:
+		DepthBuffer() = default;
+		DepthBuffer(int width, int height, DepthFormat format, bool isReversedZ);
+
+		// VisitDepthFormat with this buffer's format and direction
+		template<typename Visitor>
+		decltype(auto) VisitFormat(Visitor&& visitor) const
+		{
+			return VisitDepthFormat(m_Format, m_IsReversedZ, std::forward<Visitor>(visitor));
+		}
+
+		// Texels of the buffer's own format, rows are width apart
+		template<typename Format>
+		typename Format::Texel* GetTexels()
+		{
+			return reinterpret_cast<typename Format::Texel*>(m_Texels.data());
+		}
+		template<typename Format>
+		const typename Format::Texel* GetTexels() const
+		{
+			return reinterpret_cast<const typename Format::Texel*>(m_Texels.data());
+		}
+
+		// Back to the clear texel, streamed around the cache when nothing reads the rectangle again soon
+		void Clear(int x, int y, int width, int height, bool isStreamed);
+
+		// Farthest depth in the rectangle, decoded one step farther so quantization never moves it nearer.
+		// The largest float when any pixel still holds the clear texel.
+		float GetFarthest(int x, int y, int width, int height) const;
+
+		// Farthest sample of each pixel into the rectangle, samples holds them side by side in a buffer sampleCount times as wide
+		// and of the same format, so tests against this buffer stay conservative
+		void ResolveSamples(const DepthBuffer& samples, int sampleCount, int x, int y, int width, int height);
+
+		// Decoded depth of one pixel, for sparse reads, loops over many pixels visit the format instead
+		float GetDepth(int x, int y) const;
+
+		DepthFormat GetFormat() const
+		{
+			return m_Format;
+		}
+		bool GetIsReversedZ() const
+		{
+			return m_IsReversedZ;
+		}
+		int GetWidth() const
+		{
+			return m_Width;
+		}
+		int GetHeight() const
+		{
+			return m_Height;
+		}
+		size_t GetByteSize() const
+		{
+			return m_Texels.size();
+		}
+
+	private:
+		int m_Width{};
+		int m_Height{};
+		DepthFormat m_Format{ DepthFormat::D32F };
+		bool m_IsReversedZ{};
+		std::vector<std::byte> m_Texels;
+	};
+}
@@ -0,0 +1,56 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dae
+{
+	namespace
+	{
+		// Weight of the newest frame in the average
+		constexpr float SMOOTHING{ .2f };
+		// Largest change of the scale per frame, down and up
+		constexpr float MAX_DECREASE{ .85f };
+		constexpr float MAX_INCREASE{ 1.02f };
+		// The scale only grows while frames take less than this share of the target, so it settles instead of oscillating
+		constexpr float HEADROOM{ .9f };
+	}
+
+	float DynamicResolution::Update(float frameSeconds)
+	{
+		if (frameSeconds <= 0.f) return m_Scale;
+		m_AverageFrameTime = m_AverageFrameTime > 0.f ? m_AverageFrameTime + (frameSeconds - m_AverageFrameTime) * SMOOTHING : frameSeconds;
+
+		// Frame time mostly goes with the pixel count, the square of the scale
+		const float previousScale = m_Scale;
+		const float idealScale = m_Scale * std::sqrt(m_TargetFrameTime / m_AverageFrameTime);
+		if (idealScale < m_Scale)
+		{
+			m_Scale = std::max(idealScale, m_Scale * MAX_DECREASE);
+		}
+		else if (m_AverageFrameTime < m_TargetFrameTime * HEADROOM)
+		{
+			m_Scale = std::min(idealScale, m_Scale * MAX_INCREASE);
+		}
+		m_Scale = std::clamp(m_Scale, m_MinScale, m_MaxScale);
+
+		// The average was measured at the old scale, carried over as it is a single slow frame would lower the scale
+		// again on every frame until the average caught up. Moved to what frames should take at the new scale instead.
+		const float scaleRatio = m_Scale / previousScale;
+		m_AverageFrameTime *= scaleRatio * scaleRatio;
+		return m_Scale;
+	}
+
+	void DynamicResolution::Reset(float scale)
+	{
+		m_Scale = std::clamp(scale, m_MinScale, m_MaxScale);
+		m_AverageFrameTime = 0.f;
+	}
+
+	void DynamicResolution::SetScaleBounds(float minScale, float maxScale)
+	{
+		m_MaxScale = std::clamp(maxScale, .01f, 1.f);
+		m_MinScale = std::clamp(minScale, .01f, m_MaxScale);
+		m_Scale = std::clamp(m_Scale, m_MinScale, m_MaxScale);
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+namespace dae
+{
+	// Picks the scale of the render resolution, the same on both axes, that keeps frames near a target time.
+	// Fed the time every frame took to render, not counting waits for the display, it lowers the resolution quickly
+	// when frames run long and raises it slowly when they have time to spare.
+	class DynamicResolution final
+	{
+	public:
+		// Returns the scale to render the next frame at
+		float Update(float frameSeconds);
+
+		// Starts over at the given scale, forgetting the frame times seen so far
+		void Reset(float scale);
+
+		void SetTargetFrameTime(float seconds)
+		{
+			m_TargetFrameTime = seconds;
+		}
+
+		float GetTargetFrameTime() const
+		{
+			return m_TargetFrameTime;
+		}
+
+		// The scale never leaves [minScale, maxScale], both within (0, 1]
+		void SetScaleBounds(float minScale, float maxScale);
+
+		float GetMinScale() const
+		{
+			return m_MinScale;
+		}
+
+		float GetMaxScale() const
+		{
+			return m_MaxScale;
+		}
+
+		float GetScale() const
+		{
+			return m_Scale;
+		}
+
+	private:
+		float m_TargetFrameTime{ 1.f / 60.f };
+		float m_MinScale{ .5f };
+		float m_MaxScale{ 1.f };
+		float m_Scale{ 1.f };
+		// Smoothed over a few frames so a single slow one does not move the scale
+		float m_AverageFrameTime{};
+	};
+}
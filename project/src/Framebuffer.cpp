@@ -0,0 +1,237 @@
+#include "Framebuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Simd.h"
+
+namespace dae
+{
+	Framebuffer::Framebuffer(int width, int height) :
+		m_Width(width),
+		m_Red(static_cast<size_t>(width) * height),
+		m_Green(static_cast<size_t>(width) * height),
+		m_Blue(static_cast<size_t>(width) * height)
+	{
+	}
+
+	void Framebuffer::Fill(int x, int y, int width, int height, const ColorRGB& color)
+	{
+		for (int row = y; row < y + height; ++row)
+		{
+			const size_t first = static_cast<size_t>(row) * m_Width + x;
+			std::fill_n(&m_Red[first], width, color.r);
+			std::fill_n(&m_Green[first], width, color.g);
+			std::fill_n(&m_Blue[first], width, color.b);
+		}
+	}
+
+	void Framebuffer::ResolveSamples(const Framebuffer& samples, int sampleCount, int x, int y, int width, int height)
+	{
+		const float sampleWeight = 1.f / static_cast<float>(sampleCount);
+		const auto resolveChannel = [&](const std::vector<float>& sampleChannel, std::vector<float>& channel) {
+			for (int row = y; row < y + height; ++row)
+			{
+				const float* pSamples = &sampleChannel[(static_cast<size_t>(row) * m_Width + x) * sampleCount];
+				float* pRow = &channel[static_cast<size_t>(row) * m_Width + x];
+
+				int column = 0;
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+				// Four pixels of four samples transposed, so each register holds one sample of every pixel.
+				// Summed in sample order like the scalar loop.
+				if (sampleCount == 4)
+				{
+					for (; column + 4 <= width; column += 4)
+					{
+						__m128 sample0 = _mm_loadu_ps(pSamples + column * 4);
+						__m128 sample1 = _mm_loadu_ps(pSamples + column * 4 + 4);
+						__m128 sample2 = _mm_loadu_ps(pSamples + column * 4 + 8);
+						__m128 sample3 = _mm_loadu_ps(pSamples + column * 4 + 12);
+						_MM_TRANSPOSE4_PS(sample0, sample1, sample2, sample3);
+						const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(sample0, sample1), sample2), sample3);
+						_mm_storeu_ps(pRow + column, _mm_mul_ps(sum, _mm_set1_ps(sampleWeight)));
+					}
+				}
+#endif
+				for (; column < width; ++column)
+				{
+					float sum{};
+					for (int sample = 0; sample < sampleCount; ++sample)
+					{
+						sum += pSamples[column * sampleCount + sample];
+					}
+					pRow[column] = sum * sampleWeight;
+				}
+			}
+		};
+		resolveChannel(samples.m_Red, m_Red);
+		resolveChannel(samples.m_Green, m_Green);
+		resolveChannel(samples.m_Blue, m_Blue);
+	}
+
+	float Framebuffer::GetContrast(int x, int y, int width, int height) const
+	{
+		const auto luminance = [&](size_t pixelIndex) {
+			return .2126f * m_Red[pixelIndex] + .7152f * m_Green[pixelIndex] + .0722f * m_Blue[pixelIndex];
+		};
+
+		float differenceSum{};
+		int differenceCount{};
+		for (int row = y; row < y + height; ++row)
+		{
+			for (int column = x; column < x + width; ++column)
+			{
+				const size_t pixelIndex = static_cast<size_t>(row) * m_Width + column;
+				const float pixelLuminance = luminance(pixelIndex);
+				if (column + 1 < x + width)
+				{
+					differenceSum += std::abs(luminance(pixelIndex + 1) - pixelLuminance);
+					++differenceCount;
+				}
+				if (row + 1 < y + height)
+				{
+					differenceSum += std::abs(luminance(pixelIndex + m_Width) - pixelLuminance);
+					++differenceCount;
+				}
+			}
+		}
+		return differenceCount > 0 ? differenceSum / differenceCount : 0.f;
+	}
+
+	uint32_t Framebuffer::Pack(const ColorRGB& color)
+	{
+		// Same clamp and truncation as the vector path bit for bit, NaN included
+		const uint32_t red = static_cast<uint32_t>(std::min(std::max(0.f, color.r), 1.f) * 255.f);
+		const uint32_t green = static_cast<uint32_t>(std::min(std::max(0.f, color.g), 1.f) * 255.f);
+		const uint32_t blue = static_cast<uint32_t>(std::min(std::max(0.f, color.b), 1.f) * 255.f);
+		return red << 16 | green << 8 | blue;
+	}
+
+	void Framebuffer::Resolve(int x, int y, int width, int height, uint32_t* pPixels) const
+	{
+		for (int row = y; row < y + height; ++row)
+		{
+			const size_t first = static_cast<size_t>(row) * m_Width + x;
+			const float* pRed = &m_Red[first];
+			const float* pGreen = &m_Green[first];
+			const float* pBlue = &m_Blue[first];
+			uint32_t* pRow = &pPixels[first];
+
+			int column = 0;
+#if DAE_SIMD_LEVEL >= DAE_SIMD_AVX
+			// Whole channel values below 2^24 stay exact in floats, so they are packed with a multiply-add
+			// and converted once, AVX without AVX2 has no 256-bit integer shifts
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 one = _mm256_set1_ps(1.f);
+			const __m256 maxChannel = _mm256_set1_ps(255.f);
+			const auto toChannel = [&](const float* pChannel) {
+				const __m256 clamped = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(pChannel), zero), one);
+				return _mm256_round_ps(_mm256_mul_ps(clamped, maxChannel), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+			};
+			for (; column + 8 <= width; column += 8)
+			{
+				const __m256 packed = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(toChannel(pRed + column), _mm256_set1_ps(65536.f)),
+					_mm256_mul_ps(toChannel(pGreen + column), _mm256_set1_ps(256.f))),
+					toChannel(pBlue + column));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(pRow + column), _mm256_cvttps_epi32(packed));
+			}
+#elif DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+			// Eight pixels as two halves of four
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.f);
+			const __m128 maxChannel = _mm_set1_ps(255.f);
+			const auto toChannel = [&](const float* pChannel) {
+				const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pChannel), zero), one);
+				return _mm_cvttps_epi32(_mm_mul_ps(clamped, maxChannel));
+			};
+			const auto pack = [&](int offset) {
+				const __m128i packed = _mm_or_si128(_mm_or_si128(
+					_mm_slli_epi32(toChannel(pRed + offset), 16),
+					_mm_slli_epi32(toChannel(pGreen + offset), 8)),
+					toChannel(pBlue + offset));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pRow + offset), packed);
+			};
+			for (; column + 8 <= width; column += 8)
+			{
+				pack(column);
+				pack(column + 4);
+			}
+#endif
+			for (; column < width; ++column)
+			{
+				pRow[column] = Pack(ColorRGB{ pRed[column], pGreen[column], pBlue[column] });
+			}
+		}
+	}
+
+	void Framebuffer::Upscale(const uint32_t* pSource, int sourceWidth, int sourceHeight, uint32_t* pTarget, int width, int height, int stride,
+		int firstRow, int lastRow, int16_t* pRowScratch)
+	{
+		// Source positions of the target pixel centers in 16.16 fixed point, clamped to the outer source pixel centers.
+		// Weights are rounded to [0, 128] so a difference of two channels times a weight fits 16 bits, which keeps the vector path exact.
+		constexpr int WEIGHT_SHIFT{ 16 - 7 };
+		const int64_t columnStep = (static_cast<int64_t>(sourceWidth) << 16) / width;
+		const int64_t rowStep = (static_cast<int64_t>(sourceHeight) << 16) / height;
+		const auto toSource = [](int target, int64_t step, int sourceSize, int& first, int& weight) {
+			const int64_t position = std::clamp<int64_t>(target * step + step / 2 - (1 << 15), 0, static_cast<int64_t>(sourceSize - 1) << 16);
+			first = static_cast<int>(position >> 16);
+			weight = (static_cast<int>(position & 0xFFFF) + (1 << (WEIGHT_SHIFT - 1))) >> WEIGHT_SHIFT;
+		};
+
+		for (int row = firstRow; row < lastRow; ++row)
+		{
+			int sourceRow{}, rowWeight{};
+			toSource(row, rowStep, sourceHeight, sourceRow, rowWeight);
+			const uint8_t* pAbove = reinterpret_cast<const uint8_t*>(&pSource[static_cast<size_t>(sourceRow) * stride]);
+			const uint8_t* pBelow = reinterpret_cast<const uint8_t*>(&pSource[static_cast<size_t>(std::min(sourceRow + 1, sourceHeight - 1)) * stride]);
+
+			// Both source rows blended into one, a channel per value
+			int channel = 0;
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i verticalWeight = _mm_set1_epi16(static_cast<short>(rowWeight));
+			const auto blend = [&](__m128i above, __m128i below) {
+				return _mm_add_epi16(above, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(below, above), verticalWeight), 7));
+			};
+			for (; channel + 16 <= sourceWidth * 4; channel += 16)
+			{
+				const __m128i above = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pAbove + channel));
+				const __m128i below = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBelow + channel));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pRowScratch + channel),
+					blend(_mm_unpacklo_epi8(above, zero), _mm_unpacklo_epi8(below, zero)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pRowScratch + channel + 8),
+					blend(_mm_unpackhi_epi8(above, zero), _mm_unpackhi_epi8(below, zero)));
+			}
+#endif
+			for (; channel < sourceWidth * 4; ++channel)
+			{
+				pRowScratch[channel] = static_cast<int16_t>(pAbove[channel] + (((pBelow[channel] - pAbove[channel]) * rowWeight) >> 7));
+			}
+			// The last pixel once more, so the one right of the last column reads itself
+			std::copy_n(pRowScratch + (sourceWidth - 1) * 4, 4, pRowScratch + sourceWidth * 4);
+
+			uint32_t* pRow = &pTarget[static_cast<size_t>(row) * stride];
+			for (int column = 0; column < width; ++column)
+			{
+				int sourceColumn{}, columnWeight{};
+				toSource(column, columnStep, sourceWidth, sourceColumn, columnWeight);
+				const int16_t* pLeft = pRowScratch + sourceColumn * 4;
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+				// Left pixel in the low half, right one in the high half
+				const __m128i pair = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pLeft));
+				const __m128i blended = _mm_add_epi16(pair,
+					_mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_srli_si128(pair, 8), pair), _mm_set1_epi16(static_cast<short>(columnWeight))), 7));
+				pRow[column] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(blended, blended)));
+#else
+				uint32_t packed{};
+				for (int part = 0; part < 4; ++part)
+				{
+					const int value = pLeft[part] + (((pLeft[part + 4] - pLeft[part]) * columnWeight) >> 7);
+					packed |= static_cast<uint32_t>(value) << (part * 8);
+				}
+				pRow[column] = packed;
+#endif
+			}
+		}
+	}
+}
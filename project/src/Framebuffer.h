@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ColorRGB.h"
+
+namespace dae
+{
+	// Shaded colors as floats, one plane per channel, packed into the back buffer once per tile instead of per write.
+	// The packed format is fixed: 0x00RRGGBB, SDL_PIXELFORMAT_XRGB8888.
+	class Framebuffer final
+	{
+	public:
+		Framebuffer(int width, int height);
+
+		void SetColor(int pixelIndex, const ColorRGB& color)
+		{
+			m_Red[pixelIndex] = color.r;
+			m_Green[pixelIndex] = color.g;
+			m_Blue[pixelIndex] = color.b;
+		}
+
+		ColorRGB GetColor(int pixelIndex) const
+		{
+			return { m_Red[pixelIndex], m_Green[pixelIndex], m_Blue[pixelIndex] };
+		}
+
+		void Fill(int x, int y, int width, int height, const ColorRGB& color);
+
+		// Average of each pixel's samples into the rectangle, samples holds them side by side, sampleCount per pixel,
+		// in a framebuffer sampleCount times as wide as this one
+		void ResolveSamples(const Framebuffer& samples, int sampleCount, int x, int y, int width, int height);
+
+		// Mean absolute luminance difference between horizontal and vertical neighbours in the rectangle.
+		// Copying one color over a block keeps it about the same for smooth content, the steps between blocks make up for the flat insides.
+		float GetContrast(int x, int y, int width, int height) const;
+
+		// Clamps every channel to [0, 1] and truncates it to 8 bits, eight pixels at a time.
+		// pPixels is the packed image of the whole framebuffer, rows are framebuffer width apart.
+		void Resolve(int x, int y, int width, int height, uint32_t* pPixels) const;
+
+		static uint32_t Pack(const ColorRGB& color);
+
+		size_t GetByteSize() const
+		{
+			return (m_Red.size() + m_Green.size() + m_Blue.size()) * sizeof(float);
+		}
+
+		// Bilinear upscale of the packed sourceWidth by sourceHeight image at the top left of pSource
+		// into rows [firstRow, lastRow) of the width by height image pTarget, four channels at a time.
+		// Rows of both are stride pixels apart, pRowScratch holds 4 * (sourceWidth + 1) values.
+		static void Upscale(const uint32_t* pSource, int sourceWidth, int sourceHeight, uint32_t* pTarget, int width, int height, int stride,
+			int firstRow, int lastRow, int16_t* pRowScratch);
+
+	private:
+		int m_Width{};
+		std::vector<float> m_Red;
+		std::vector<float> m_Green;
+		std::vector<float> m_Blue;
+	};
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "Maths.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	struct Frustum
+	{
+		// Left, Right, Bottom, Top, Near, Far - normals point inwards
+		Vector4 planes[6]{};
+
+		// Gribb/Hartmann plane extraction for row vectors (p * M) and a [0, 1] depth range.
+		// With reversed-Z the near and far planes swap places, the same two planes still bound the frustum.
+		static Frustum FromMatrix(const Matrix& viewProjection)
+		{
+			const Vector4 column0{ viewProjection[0].x, viewProjection[1].x, viewProjection[2].x, viewProjection[3].x };
+			const Vector4 column1{ viewProjection[0].y, viewProjection[1].y, viewProjection[2].y, viewProjection[3].y };
+			const Vector4 column2{ viewProjection[0].z, viewProjection[1].z, viewProjection[2].z, viewProjection[3].z };
+			const Vector4 column3{ viewProjection[0].w, viewProjection[1].w, viewProjection[2].w, viewProjection[3].w };
+
+			Frustum frustum{};
+			frustum.planes[0] = column3 + column0;
+			frustum.planes[1] = column3 - column0;
+			frustum.planes[2] = column3 + column1;
+			frustum.planes[3] = column3 - column1;
+			frustum.planes[4] = column2;
+			frustum.planes[5] = column3 - column2;
+
+			for (Vector4& plane : frustum.planes)
+			{
+				// The far plane of an infinite projection has no normal, only a positive w every point passes
+				const float length = Vector3{ plane.x, plane.y, plane.z }.Magnitude();
+				if (length == 0.f) continue;
+
+				// Vector4::operator/ keeps w, so scale explicitly
+				const float inverseLength = 1.f / length;
+				plane = plane * inverseLength;
+			}
+
+			return frustum;
+		}
+
+		bool IsSphereVisible(const BoundingSphere& sphere) const
+		{
+			for (const Vector4& plane : planes)
+			{
+				if (DistanceToPlane(plane, sphere.center) < -sphere.radius) return false;
+			}
+			return true;
+		}
+
+		bool IsBoxVisible(const BoundingBox& box) const
+		{
+			for (const Vector4& plane : planes)
+			{
+				// Test the corner furthest along the plane normal
+				const Vector3 positiveVertex{
+					plane.x >= 0.f ? box.max.x : box.min.x,
+					plane.y >= 0.f ? box.max.y : box.min.y,
+					plane.z >= 0.f ? box.max.z : box.min.z
+				};
+				if (DistanceToPlane(plane, positiveVertex) < 0.f) return false;
+			}
+			return true;
+		}
+
+		static float DistanceToPlane(const Vector4& plane, const Vector3& point)
+		{
+			return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+		}
+	};
+}
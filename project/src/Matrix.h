@@ -1,4 +1,11 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include "MathHelpers.h"
+#include "Simd.h"
 #include "Vector3.h"
 #include "Vector4.h"
 
@@ -6,58 +13,78 @@ namespace dae {
 	struct Matrix
 	{
 		Matrix() = default;
-		Matrix(
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
 			const Vector3& t);
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
 			const Vector4& t);
 
-		Matrix(const Matrix& m);
+		constexpr Vector3 TransformVector(const Vector3& v) const;
+		constexpr Vector3 TransformVector(float x, float y, float z) const;
+		constexpr Vector3 TransformPoint(const Vector3& p) const;
+		constexpr Vector3 TransformPoint(float x, float y, float z) const;
 
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
+		constexpr Vector4 TransformPoint(const Vector4& p) const;
+		constexpr Vector4 TransformPoint(float x, float y, float z, float w) const;
+		// Transforms every point with w = 1, result needs at least as many elements as points
+		void TransformPoints(std::span<const Vector3> points, std::span<Vector4> result) const;
 
-		Vector4 TransformPoint(const Vector4& p) const;
-		Vector4 TransformPoint(float x, float y, float z, float w) const;
-
-		const Matrix& Transpose();
+		constexpr const Matrix& Transpose();
 		const Matrix& Inverse();
 
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
+		constexpr Vector3 GetAxisX() const;
+		constexpr Vector3 GetAxisY() const;
+		constexpr Vector3 GetAxisZ() const;
+		constexpr Vector3 GetTranslation() const;
 
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
+		static constexpr Matrix CreateTranslation(float x, float y, float z);
+		static constexpr Matrix CreateTranslation(const Vector3& t);
 		static Matrix CreateRotationX(float pitch);
 		static Matrix CreateRotationY(float yaw);
 		static Matrix CreateRotationZ(float roll);
 		static Matrix CreateRotation(float pitch, float yaw, float roll);
 		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
+		static constexpr Matrix CreateScale(float sx, float sy, float sz);
+		static constexpr Matrix CreateScale(const Vector3& s);
+		static constexpr Matrix Transpose(const Matrix& m);
 		static Matrix Inverse(const Matrix& m);
 
 		static Matrix CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up);
-		static Matrix CreatePerspectiveFovLH(float fovy, float aspect, float zn, float zf);
+		// fov is tan(fovy / 2), folds to a constant when the arguments are.
+		// Depth 0 at the near plane and 1 at the far one, zf may be infinity.
+		static constexpr Matrix CreatePerspectiveFovLH(float fov, float aspect, float zn, float zf);
+		// Depth 1 at the near plane and 0 at the far one, float depth then keeps its precision into the distance. zf may be infinity.
+		static constexpr Matrix CreateReversedPerspectiveFovLH(float fov, float aspect, float zn, float zf);
 
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+		constexpr Vector4& operator[](int index);
+		constexpr Vector4 operator[](int index) const;
+		constexpr Matrix operator*(const Matrix& m) const;
+		constexpr const Matrix& operator*=(const Matrix& m);
 		bool operator==(const Matrix& m) const;
 
 	private:
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+		// Summed in the same order as the scalar path, so both back ends give the same result
+		__m128 TransformRows(float x, float y, float z) const
+		{
+			__m128 result{ _mm_mul_ps(_mm_loadu_ps(&data[0].x), _mm_set1_ps(x)) };
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(&data[1].x), _mm_set1_ps(y)));
+			return _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(&data[2].x), _mm_set1_ps(z)));
+		}
+
+		static Vector3 ToVector3(__m128 v)
+		{
+			alignas(16) float values[4];
+			_mm_store_ps(values, v);
+			return { values[0], values[1], values[2] };
+		}
+#endif
 
 		//Row-Major Matrix
 		Vector4 data[4]
@@ -73,4 +100,363 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
-}
\ No newline at end of file
+
+	constexpr Matrix::Matrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
+		Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+	{
+	}
+
+	constexpr Matrix::Matrix(const Vector4& xAxis, const Vector4& yAxis, const Vector4& zAxis, const Vector4& t) :
+		data{ xAxis, yAxis, zAxis, t }
+	{
+	}
+
+	// The SIMD paths only run outside constant evaluation, the scalar ones sum in the same order
+	constexpr Vector3 Matrix::TransformVector(const Vector3& v) const
+	{
+		return TransformVector(v.x, v.y, v.z);
+	}
+
+	constexpr Vector3 Matrix::TransformVector(float x, float y, float z) const
+	{
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+		if (!std::is_constant_evaluated()) return ToVector3(TransformRows(x, y, z));
+#endif
+		return Vector3{
+			data[0].x * x + data[1].x * y + data[2].x * z,
+			data[0].y * x + data[1].y * y + data[2].y * z,
+			data[0].z * x + data[1].z * y + data[2].z * z
+		};
+	}
+
+	constexpr Vector3 Matrix::TransformPoint(const Vector3& p) const
+	{
+		return TransformPoint(p.x, p.y, p.z);
+	}
+
+	constexpr Vector3 Matrix::TransformPoint(float x, float y, float z) const
+	{
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+		if (!std::is_constant_evaluated()) return ToVector3(_mm_add_ps(TransformRows(x, y, z), _mm_loadu_ps(&data[3].x)));
+#endif
+		return Vector3{
+			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+		};
+	}
+
+	constexpr Vector4 Matrix::TransformPoint(const Vector4& p) const
+	{
+		return TransformPoint(p.x, p.y, p.z, p.w);
+	}
+
+	constexpr Vector4 Matrix::TransformPoint(float x, float y, float z, float) const
+	{
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+		if (!std::is_constant_evaluated())
+		{
+			Vector4 result;
+			_mm_storeu_ps(&result.x, _mm_add_ps(TransformRows(x, y, z), _mm_loadu_ps(&data[3].x)));
+			return result;
+		}
+#endif
+		return Vector4{
+			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+			data[0].w * x + data[1].w * y + data[2].w * z + data[3].w
+		};
+	}
+
+	inline void Matrix::TransformPoints(std::span<const Vector3> points, std::span<Vector4> result) const
+	{
+		assert(result.size() >= points.size());
+
+		size_t index{ 0 };
+#if DAE_SIMD_LEVEL >= DAE_SIMD_AVX
+		// Two points per iteration, each 128-bit lane holds one result row
+		const __m256 row0{ _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&data[0].x)) };
+		const __m256 row1{ _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&data[1].x)) };
+		const __m256 row2{ _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&data[2].x)) };
+		const __m256 row3{ _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&data[3].x)) };
+
+		for (; index + 1 < points.size(); index += 2)
+		{
+			const Vector3& p0{ points[index] };
+			const Vector3& p1{ points[index + 1] };
+
+			__m256 transformed{ _mm256_mul_ps(row0, _mm256_setr_ps(p0.x, p0.x, p0.x, p0.x, p1.x, p1.x, p1.x, p1.x)) };
+			transformed = _mm256_add_ps(transformed, _mm256_mul_ps(row1, _mm256_setr_ps(p0.y, p0.y, p0.y, p0.y, p1.y, p1.y, p1.y, p1.y)));
+			transformed = _mm256_add_ps(transformed, _mm256_mul_ps(row2, _mm256_setr_ps(p0.z, p0.z, p0.z, p0.z, p1.z, p1.z, p1.z, p1.z)));
+			_mm256_storeu_ps(&result[index].x, _mm256_add_ps(transformed, row3));
+		}
+#endif
+		for (; index < points.size(); ++index)
+		{
+			const Vector3& p{ points[index] };
+			result[index] = TransformPoint(p.x, p.y, p.z, 1.f);
+		}
+	}
+
+	constexpr const Matrix& Matrix::Transpose()
+	{
+		Matrix result{};
+		for (int r{ 0 }; r < 4; ++r)
+		{
+			for (int c{ 0 }; c < 4; ++c)
+			{
+				result[r][c] = data[c][r];
+			}
+		}
+
+		data[0] = result[0];
+		data[1] = result[1];
+		data[2] = result[2];
+		data[3] = result[3];
+
+		return *this;
+	}
+
+	inline const Matrix& Matrix::Inverse()
+	{
+		//Optimized Inverse as explained in FGED1 - used widely in other libraries too.
+		const Vector3& a = data[0];
+		const Vector3& b = data[1];
+		const Vector3& c = data[2];
+		const Vector3& d = data[3];
+
+		const float x = data[0][3];
+		const float y = data[1][3];
+		const float z = data[2][3];
+		const float w = data[3][3];
+
+		Vector3 s = Vector3::Cross(a, b);
+		Vector3 t = Vector3::Cross(c, d);
+		Vector3 u = a * y - b * x;
+		Vector3 v = c * w - d * z;
+
+		float det = Vector3::Dot(s, v) + Vector3::Dot(t, u);
+		assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+		float invDet = 1.f / det;
+
+		s *= invDet; t *= invDet; u *= invDet; v *= invDet;
+
+		Vector3 r0 = Vector3::Cross(b, v) + t * y;
+		Vector3 r1 = Vector3::Cross(v, a) - t * x;
+		Vector3 r2 = Vector3::Cross(d, u) + s * w;
+		Vector3 r3 = Vector3::Cross(u, c) - s * z;
+
+		data[0] = Vector4{ r0.x, r1.x, r2.x, r3.x };
+		data[1] = Vector4{ r0.y, r1.y, r2.y, r3.y };
+		data[2] = Vector4{ r0.z, r1.z, r2.z, r3.z };
+		data[3] = { { -Vector3::Dot(b, t)},{Vector3::Dot(a, t)},{-Vector3::Dot(d, s)},{Vector3::Dot(c, s)} };
+
+		return *this;
+	}
+
+	constexpr Matrix Matrix::Transpose(const Matrix& m)
+	{
+		Matrix out{ m };
+		out.Transpose();
+
+		return out;
+	}
+
+	inline Matrix Matrix::Inverse(const Matrix& m)
+	{
+		Matrix out{ m };
+		out.Inverse();
+
+		return out;
+	}
+
+	inline Matrix Matrix::CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up)
+	{
+		auto zaxis = forward.Normalized();
+		auto xaxis = Vector3::Cross(up, zaxis).Normalized();
+		auto yaxis = Vector3::Cross(zaxis, xaxis);
+
+		return Matrix(Vector4(xaxis, -Vector3::Dot(xaxis, origin)), Vector4(yaxis, -Vector3::Dot(yaxis, origin)), Vector4(zaxis, -Vector3::Dot(zaxis, origin)),
+				Vector4(0, 0, 0, 1)).Transpose();
+	}
+
+	constexpr Matrix Matrix::CreatePerspectiveFovLH(float fov, float aspect, float zn, float zf)
+	{
+
+		auto yscale = 1.f / fov;
+		auto xscale = yscale / aspect;
+
+		// Limits as zf goes to infinity
+		const bool isInfinite = zf == std::numeric_limits<float>::infinity();
+		const float zscale = isInfinite ? 1.f : zf/(zf-zn);
+		const float zoffset = isInfinite ? -zn : (-zn*zf)/(zf-zn);
+
+		return Matrix(
+					Vector4(xscale, 0.f, 0.f, 0.f),
+					Vector4(0.f, yscale, 0.f, 0.f),
+					Vector4(0.f, 0.f, zscale, 1.f),
+					Vector4(0.f, 0.f, zoffset, 0.f)
+		);
+	}
+
+	constexpr Matrix Matrix::CreateReversedPerspectiveFovLH(float fov, float aspect, float zn, float zf)
+	{
+		auto yscale = 1.f / fov;
+		auto xscale = yscale / aspect;
+
+		// One minus the standard depth, and its limits as zf goes to infinity
+		const bool isInfinite = zf == std::numeric_limits<float>::infinity();
+		const float zscale = isInfinite ? 0.f : zn/(zn-zf);
+		const float zoffset = isInfinite ? zn : (zn*zf)/(zf-zn);
+
+		return Matrix(
+					Vector4(xscale, 0.f, 0.f, 0.f),
+					Vector4(0.f, yscale, 0.f, 0.f),
+					Vector4(0.f, 0.f, zscale, 1.f),
+					Vector4(0.f, 0.f, zoffset, 0.f)
+		);
+	}
+
+	constexpr Vector3 Matrix::GetAxisX() const
+	{
+		return data[0];
+	}
+
+	constexpr Vector3 Matrix::GetAxisY() const
+	{
+		return data[1];
+	}
+
+	constexpr Vector3 Matrix::GetAxisZ() const
+	{
+		return data[2];
+	}
+
+	constexpr Vector3 Matrix::GetTranslation() const
+	{
+		return data[3];
+	}
+
+	constexpr Matrix Matrix::CreateTranslation(float x, float y, float z)
+	{
+		return CreateTranslation({ x, y, z });
+	}
+
+	constexpr Matrix Matrix::CreateTranslation(const Vector3& t)
+	{
+		return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+	}
+
+	inline Matrix Matrix::CreateRotationX(float pitch)
+	{
+		return {
+			{1, 0, 0, 0},
+			{0, std::cos(pitch), -std::sin(pitch), 0},
+			{0, std::sin(pitch), std::cos(pitch), 0},
+			{0, 0, 0, 1}
+		};
+	}
+
+	inline Matrix Matrix::CreateRotationY(float yaw)
+	{
+		return {
+			{std::cos(yaw), 0, -std::sin(yaw), 0},
+			{0, 1, 0, 0},
+			{std::sin(yaw), 0, std::cos(yaw), 0},
+			{0, 0, 0, 1}
+		};
+	}
+
+	inline Matrix Matrix::CreateRotationZ(float roll)
+	{
+		return {
+			{std::cos(roll), std::sin(roll), 0, 0},
+			{-std::sin(roll), std::cos(roll), 0, 0},
+			{0, 0, 1, 0},
+			{0, 0, 0, 1}
+		};
+	}
+
+	inline Matrix Matrix::CreateRotation(float pitch, float yaw, float roll)
+	{
+		return CreateRotation({ pitch, yaw, roll });
+	}
+
+	inline Matrix Matrix::CreateRotation(const Vector3& r)
+	{
+		return CreateRotationX(r[0]) * CreateRotationY(r[1]) * CreateRotationZ(r[2]);
+	}
+
+	constexpr Matrix Matrix::CreateScale(float sx, float sy, float sz)
+	{
+		return { {sx, 0, 0}, {0, sy, 0}, {0, 0, sz}, Vector3::Zero };
+	}
+
+	constexpr Matrix Matrix::CreateScale(const Vector3& s)
+	{
+		return CreateScale(s[0], s[1], s[2]);
+	}
+
+#pragma region Operator Overloads
+	constexpr Vector4& Matrix::operator[](int index)
+	{
+		assert(index <= 3 && index >= 0);
+		return data[index];
+	}
+
+	constexpr Vector4 Matrix::operator[](int index) const
+	{
+		assert(index <= 3 && index >= 0);
+		return data[index];
+	}
+
+	constexpr Matrix Matrix::operator*(const Matrix& m) const
+	{
+		Matrix result{};
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+		if (!std::is_constant_evaluated())
+		{
+			// Each result row is this row's components weighting the rows of m
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				__m128 row{ _mm_mul_ps(_mm_loadu_ps(&m.data[0].x), _mm_set1_ps(data[r].x)) };
+				row = _mm_add_ps(row, _mm_mul_ps(_mm_loadu_ps(&m.data[1].x), _mm_set1_ps(data[r].y)));
+				row = _mm_add_ps(row, _mm_mul_ps(_mm_loadu_ps(&m.data[2].x), _mm_set1_ps(data[r].z)));
+				row = _mm_add_ps(row, _mm_mul_ps(_mm_loadu_ps(&m.data[3].x), _mm_set1_ps(data[r].w)));
+				_mm_storeu_ps(&result.data[r].x, row);
+			}
+			return result;
+		}
+#endif
+		Matrix m_transposed = Transpose(m);
+
+		for (int r{ 0 }; r < 4; ++r)
+		{
+			for (int c{ 0 }; c < 4; ++c)
+			{
+				result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
+			}
+		}
+
+		return result;
+	}
+
+	constexpr const Matrix& Matrix::operator*=(const Matrix& m)
+	{
+		*this = *this * m;
+		return *this;
+	}
+
+	inline bool Matrix::operator==(const Matrix& m) const
+	{
+		return data[0] == m.data[0]
+		    && data[1] == m.data[1]
+			&& data[2] == m.data[2]
+			&& data[3] == m.data[3];
+	}
+
+#pragma endregion
+
+	static_assert(std::is_trivially_copyable_v<Matrix>);
+}
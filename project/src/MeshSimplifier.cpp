@@ -0,0 +1,320 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <numeric>
+
+namespace dae
+{
+	namespace
+	{
+		// Symmetric 4x4 matrix, upper triangle only
+		struct Quadric
+		{
+			double a00{}, a01{}, a02{}, a03{};
+			double a11{}, a12{}, a13{};
+			double a22{}, a23{};
+			double a33{};
+
+			static Quadric FromPlane(double a, double b, double c, double d)
+			{
+				return { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+			}
+
+			Quadric& operator+=(const Quadric& q)
+			{
+				a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+				a11 += q.a11; a12 += q.a12; a13 += q.a13;
+				a22 += q.a22; a23 += q.a23;
+				a33 += q.a33;
+				return *this;
+			}
+
+			// Sum of squared distances from p to the accumulated planes
+			double Evaluate(const Vector3& p) const
+			{
+				const double x = p.x, y = p.y, z = p.z;
+				return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+					+ a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+					+ a22 * z * z + 2 * a23 * z
+					+ a33;
+			}
+		};
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			double error;
+		};
+
+		// Offsets/items adjacency, rebuilt every pass
+		struct Adjacency
+		{
+			std::vector<uint32_t> offsets{};
+			std::vector<uint32_t> items{};
+		};
+	}
+
+	std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float* pResultError)
+	{
+		if (pResultError) *pResultError = 0.f;
+		if (indices.size() <= targetIndexCount || vertices.empty()) return indices;
+
+		// Weld identical positions, the collapses happen between welded positions
+		std::vector<uint32_t> sortedVertices(vertices.size());
+		std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+		auto lessPosition = [&](uint32_t a, uint32_t b)
+		{
+			const Vector3& pa = vertices[a].position;
+			const Vector3& pb = vertices[b].position;
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			return pa.z < pb.z;
+		};
+		std::sort(sortedVertices.begin(), sortedVertices.end(), lessPosition);
+
+		std::vector<uint32_t> positionOfVertex(vertices.size());
+		std::vector<Vector3> positions{};
+		Adjacency cornersOfPosition{};
+		for (size_t i{ 0 }; i < sortedVertices.size(); ++i)
+		{
+			if (i == 0 || lessPosition(sortedVertices[i - 1], sortedVertices[i]))
+			{
+				positions.push_back(vertices[sortedVertices[i]].position);
+				cornersOfPosition.offsets.push_back(static_cast<uint32_t>(i));
+			}
+			positionOfVertex[sortedVertices[i]] = static_cast<uint32_t>(positions.size()) - 1;
+		}
+		cornersOfPosition.offsets.push_back(static_cast<uint32_t>(sortedVertices.size()));
+		cornersOfPosition.items = sortedVertices;
+
+		const size_t positionCount = positions.size();
+		const size_t triangleCount = indices.size() / 3;
+
+		// Triangles keep both their welded positions and the original vertices at their corners
+		std::vector<uint32_t> trianglePositions(triangleCount * 3);
+		std::vector<uint32_t> triangleVertices(indices.begin(), indices.begin() + triangleCount * 3);
+		for (size_t i{ 0 }; i < triangleVertices.size(); ++i)
+		{
+			trianglePositions[i] = positionOfVertex[triangleVertices[i]];
+		}
+
+		// Plane quadrics
+		std::vector<Quadric> quadrics(positionCount);
+		for (size_t triangle{ 0 }; triangle < triangleCount; ++triangle)
+		{
+			const Vector3& p0 = positions[trianglePositions[triangle * 3]];
+			const Vector3& p1 = positions[trianglePositions[triangle * 3 + 1]];
+			const Vector3& p2 = positions[trianglePositions[triangle * 3 + 2]];
+
+			Vector3 normal = Vector3::Cross(p1 - p0, p2 - p0);
+			const float length = normal.Magnitude();
+			if (length <= FLT_EPSILON) continue;
+			normal /= length;
+
+			const Quadric quadric = Quadric::FromPlane(normal.x, normal.y, normal.z, -Vector3::Dot(normal, p0));
+			for (int corner{ 0 }; corner < 3; ++corner)
+			{
+				quadrics[trianglePositions[triangle * 3 + corner]] += quadric;
+			}
+		}
+
+		// Lock positions on open borders and on UV seams
+		std::vector<bool> isLocked(positionCount, false);
+		{
+			std::vector<uint64_t> edges{};
+			edges.reserve(triangleCount * 3);
+			for (size_t triangle{ 0 }; triangle < triangleCount; ++triangle)
+			{
+				for (int corner{ 0 }; corner < 3; ++corner)
+				{
+					const uint64_t a = trianglePositions[triangle * 3 + corner];
+					const uint64_t b = trianglePositions[triangle * 3 + (corner + 1) % 3];
+					if (a == b) continue;
+					edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			for (size_t i{ 0 }; i < edges.size();)
+			{
+				size_t j{ i };
+				while (j < edges.size() && edges[j] == edges[i]) ++j;
+				if (j - i == 1)
+				{
+					isLocked[edges[i] >> 32] = true;
+					isLocked[edges[i] & 0xFFFFFFFF] = true;
+				}
+				i = j;
+			}
+
+			for (size_t position{ 0 }; position < positionCount; ++position)
+			{
+				const Vector2& uv = vertices[cornersOfPosition.items[cornersOfPosition.offsets[position]]].uv;
+				for (uint32_t i{ cornersOfPosition.offsets[position] + 1 }; i < cornersOfPosition.offsets[position + 1]; ++i)
+				{
+					const Vector2& otherUv = vertices[cornersOfPosition.items[i]].uv;
+					if (!AreEqual(uv.x, otherUv.x, 1e-4f) || !AreEqual(uv.y, otherUv.y, 1e-4f))
+					{
+						isLocked[position] = true;
+						break;
+					}
+				}
+			}
+		}
+
+		std::vector<uint32_t> remap(positionCount);
+		std::vector<bool> isTouched(positionCount);
+		std::vector<Collapse> collapses{};
+		Adjacency trianglesOfPosition{};
+		size_t liveTriangleCount{ triangleCount };
+		const size_t targetTriangleCount{ targetIndexCount / 3 };
+		double maxError{ 0.0 };
+
+		while (liveTriangleCount > targetTriangleCount)
+		{
+			// Adjacency of the current triangles
+			trianglesOfPosition.offsets.assign(positionCount + 1, 0);
+			for (size_t i{ 0 }; i < liveTriangleCount * 3; ++i)
+			{
+				++trianglesOfPosition.offsets[trianglePositions[i] + 1];
+			}
+			std::partial_sum(trianglesOfPosition.offsets.begin(), trianglesOfPosition.offsets.end(), trianglesOfPosition.offsets.begin());
+			trianglesOfPosition.items.resize(liveTriangleCount * 3);
+			{
+				std::vector<uint32_t> cursor(trianglesOfPosition.offsets.begin(), trianglesOfPosition.offsets.end() - 1);
+				for (size_t i{ 0 }; i < liveTriangleCount * 3; ++i)
+				{
+					trianglesOfPosition.items[cursor[trianglePositions[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+
+			// Cheapest direction of every edge, the collapsed vertex lands on one of the endpoints
+			collapses.clear();
+			for (size_t triangle{ 0 }; triangle < liveTriangleCount; ++triangle)
+			{
+				for (int corner{ 0 }; corner < 3; ++corner)
+				{
+					const uint32_t a = trianglePositions[triangle * 3 + corner];
+					const uint32_t b = trianglePositions[triangle * 3 + (corner + 1) % 3];
+					if (a > b || (isLocked[a] && isLocked[b])) continue;
+
+					Quadric quadric = quadrics[a];
+					quadric += quadrics[b];
+					const double errorAtA = isLocked[b] ? DBL_MAX : quadric.Evaluate(positions[a]);
+					const double errorAtB = isLocked[a] ? DBL_MAX : quadric.Evaluate(positions[b]);
+					collapses.push_back(errorAtB <= errorAtA ? Collapse{ a, b, errorAtB } : Collapse{ b, a, errorAtA });
+				}
+			}
+			if (collapses.empty()) break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			// Apply the cheapest independent collapses of this pass
+			std::iota(remap.begin(), remap.end(), 0);
+			std::fill(isTouched.begin(), isTouched.end(), false);
+			size_t removedTriangles{ 0 };
+			const size_t trianglesToRemove{ liveTriangleCount - targetTriangleCount };
+
+			// Only the cheapest part of the candidates is considered, the rest is re-evaluated next pass with updated quadrics
+			const size_t candidateCount{ std::max<size_t>(collapses.size() / 4, 1) };
+			for (size_t candidate{ 0 }; candidate < candidateCount; ++candidate)
+			{
+				const Collapse& collapse = collapses[candidate];
+				if (removedTriangles >= trianglesToRemove) break;
+				if (isTouched[collapse.from] || isTouched[collapse.to]) continue;
+
+				// Reject collapses that flip a neighbouring triangle
+				bool isFlipping{ false };
+				size_t sharedTriangles{ 0 };
+				for (uint32_t i{ trianglesOfPosition.offsets[collapse.from] }; i < trianglesOfPosition.offsets[collapse.from + 1] && !isFlipping; ++i)
+				{
+					const uint32_t* pTriangle = &trianglePositions[trianglesOfPosition.items[i] * 3];
+					if (pTriangle[0] == collapse.to || pTriangle[1] == collapse.to || pTriangle[2] == collapse.to)
+					{
+						++sharedTriangles;
+						continue;
+					}
+
+					Vector3 before[3]{ positions[pTriangle[0]], positions[pTriangle[1]], positions[pTriangle[2]] };
+					Vector3 after[3]{ before[0], before[1], before[2] };
+					for (int corner{ 0 }; corner < 3; ++corner)
+					{
+						if (pTriangle[corner] == collapse.from) after[corner] = positions[collapse.to];
+					}
+
+					const Vector3 normalBefore = Vector3::Cross(before[1] - before[0], before[2] - before[0]);
+					const Vector3 normalAfter = Vector3::Cross(after[1] - after[0], after[2] - after[0]);
+					isFlipping = Vector3::Dot(normalBefore, normalAfter) <= 0.f;
+				}
+				if (isFlipping) continue;
+
+				// Neighbours are frozen for the rest of the pass so the flip test above stays valid
+				for (uint32_t i{ trianglesOfPosition.offsets[collapse.from] }; i < trianglesOfPosition.offsets[collapse.from + 1]; ++i)
+				{
+					const uint32_t* pTriangle = &trianglePositions[trianglesOfPosition.items[i] * 3];
+					isTouched[pTriangle[0]] = isTouched[pTriangle[1]] = isTouched[pTriangle[2]] = true;
+				}
+				for (uint32_t i{ trianglesOfPosition.offsets[collapse.to] }; i < trianglesOfPosition.offsets[collapse.to + 1]; ++i)
+				{
+					const uint32_t* pTriangle = &trianglePositions[trianglesOfPosition.items[i] * 3];
+					isTouched[pTriangle[0]] = isTouched[pTriangle[1]] = isTouched[pTriangle[2]] = true;
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to] += quadrics[collapse.from];
+				maxError = std::max(maxError, collapse.error);
+				removedTriangles += sharedTriangles;
+			}
+			if (removedTriangles == 0) break;
+
+			// Move the corners onto the surviving positions and compact away the degenerate triangles
+			size_t writeTriangle{ 0 };
+			for (size_t triangle{ 0 }; triangle < liveTriangleCount; ++triangle)
+			{
+				uint32_t newPositions[3]{};
+				uint32_t newVertices[3]{};
+				for (int corner{ 0 }; corner < 3; ++corner)
+				{
+					const uint32_t position = trianglePositions[triangle * 3 + corner];
+					const uint32_t vertex = triangleVertices[triangle * 3 + corner];
+					newPositions[corner] = remap[position];
+					newVertices[corner] = vertex;
+
+					if (remap[position] == position) continue;
+
+					// Reuse the vertex at the new position whose UV matches the old corner best
+					float bestDistance{ FLT_MAX };
+					const Vector2& uv = vertices[vertex].uv;
+					for (uint32_t i{ cornersOfPosition.offsets[remap[position]] }; i < cornersOfPosition.offsets[remap[position] + 1]; ++i)
+					{
+						const uint32_t candidate = cornersOfPosition.items[i];
+						const float distance = (vertices[candidate].uv - uv).SqrMagnitude();
+						if (distance < bestDistance)
+						{
+							bestDistance = distance;
+							newVertices[corner] = candidate;
+						}
+					}
+				}
+
+				if (newPositions[0] == newPositions[1] || newPositions[1] == newPositions[2] || newPositions[2] == newPositions[0]) continue;
+
+				for (int corner{ 0 }; corner < 3; ++corner)
+				{
+					trianglePositions[writeTriangle * 3 + corner] = newPositions[corner];
+					triangleVertices[writeTriangle * 3 + corner] = newVertices[corner];
+				}
+				++writeTriangle;
+			}
+			liveTriangleCount = writeTriangle;
+		}
+
+		if (pResultError) *pResultError = static_cast<float>(std::sqrt(std::max(maxError, 0.0)));
+
+		triangleVertices.resize(liveTriangleCount * 3);
+		return triangleVertices;
+	}
+}
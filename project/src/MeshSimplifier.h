@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "DataTypes.h"
+
+namespace dae
+{
+	// Quadric error metric edge collapse (Garland & Heckbert).
+	// Works on welded positions, so the per-corner vertices ParseOBJ produces still collapse,
+	// and returns a triangle list that references the original vertices.
+	// Open borders and UV seams are locked to avoid cracks and texture swimming.
+	std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float* pResultError = nullptr);
+}
@@ -0,0 +1,350 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "Simd.h"
+
+namespace dae
+{
+	namespace
+	{
+		constexpr float EMPTY_DEPTH{ FLT_MAX };
+
+		// Coarse pixel coordinates and post-projection depth, reversed depth is mirrored back so nearer is always smaller
+		Vector4 ToOcclusionSpace(const Vector4& clip, bool isReversedZ)
+		{
+			const float inverseW = 1.f / clip.w;
+			const float depth = clip.z * inverseW;
+			return Vector4{
+				(clip.x * inverseW * 0.5f + 0.5f) * OcclusionBuffer::WIDTH,
+				(1.f - clip.y * inverseW) * 0.5f * OcclusionBuffer::HEIGHT,
+				isReversedZ ? 1.f - depth : depth,
+				clip.w
+			};
+		}
+
+		// Depth 0 is the near plane, or depth 1 with reversed-Z
+		bool IsNearerThanNearPlane(const Vector4& clip, bool isReversedZ)
+		{
+			return isReversedZ ? clip.z > clip.w : clip.z < 0.f;
+		}
+
+		// The full resolution rasterizer drops triangles reaching this far out, so they cannot occlude anything either
+		bool IsInsideGuardBand(const Vector4& point)
+		{
+			return point.x >= -OcclusionBuffer::WIDTH && point.x <= OcclusionBuffer::WIDTH
+				&& point.y >= -OcclusionBuffer::HEIGHT && point.y <= OcclusionBuffer::HEIGHT
+				&& point.z >= 0.f && point.z <= 1.f;
+		}
+
+		int ClampToPixel(float value, int size)
+		{
+			return static_cast<int>(std::clamp(value, 0.f, static_cast<float>(size)));
+		}
+	}
+
+	OcclusionBuffer::OcclusionBuffer() :
+		m_Depth(WIDTH * HEIGHT, EMPTY_DEPTH),
+		m_HistoryDepth(WIDTH * HEIGHT, EMPTY_DEPTH),
+		m_FilteredDepth(WIDTH * HEIGHT, EMPTY_DEPTH)
+	{
+	}
+
+	bool OcclusionBuffer::BeginFrame(const Matrix& viewProjection, bool isReversedZ, bool isHistoryValid)
+	{
+		m_ViewProjection = viewProjection;
+		m_IsReversedZ = isReversedZ;
+
+		if (isHistoryValid && m_HasHistory)
+		{
+			ReprojectHistory();
+			return true;
+		}
+
+		std::fill(m_Depth.begin(), m_Depth.end(), EMPTY_DEPTH);
+		return false;
+	}
+
+	void OcclusionBuffer::RasterizeOccluder(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const Matrix& worldViewProjection,
+		float shrinkPerDepth)
+	{
+		for (size_t index = 0; index + 2 < indices.size(); index += 3)
+		{
+			Vector4 points[3]{};
+			bool isDropped{ false };
+			for (int corner{ 0 }; corner < 3; ++corner)
+			{
+				const Vertex& vertex = vertices[indices[index + corner]];
+
+				// Occluders only have to be conservative, triangles crossing the near plane are dropped
+				const Vector4 clip = worldViewProjection.TransformPoint(vertex.position.ToVector4());
+				if (IsNearerThanNearPlane(clip, m_IsReversedZ) || !IsInsideGuardBand(ToOcclusionSpace(clip, m_IsReversedZ)))
+				{
+					isDropped = true;
+					break;
+				}
+
+				// Pulling the vertex inwards by a distance that grows with its depth keeps the silhouette inside the real one on screen
+				const Vector4 shrunk = worldViewProjection.TransformPoint((vertex.position - vertex.normal * (clip.w * shrinkPerDepth)).ToVector4());
+				if (IsNearerThanNearPlane(shrunk, m_IsReversedZ))
+				{
+					isDropped = true;
+					break;
+				}
+				points[corner] = ToOcclusionSpace(shrunk, m_IsReversedZ);
+			}
+
+			if (!isDropped) RasterizeTriangle(points[0], points[1], points[2]);
+		}
+	}
+
+	void OcclusionBuffer::RasterizeTriangle(const Vector4& v0, const Vector4& v1, const Vector4& v2)
+	{
+		// Same winding as the full resolution rasterizer, back faces and degenerate triangles are skipped
+		const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		if (area <= 0.f) return;
+
+		const int minX = ClampToPixel(std::floor(std::min({ v0.x, v1.x, v2.x })), WIDTH);
+		const int maxX = ClampToPixel(std::ceil(std::max({ v0.x, v1.x, v2.x })), WIDTH);
+		const int minY = ClampToPixel(std::floor(std::min({ v0.y, v1.y, v2.y })), HEIGHT);
+		const int maxY = ClampToPixel(std::ceil(std::max({ v0.y, v1.y, v2.y })), HEIGHT);
+		if (minX >= maxX || minY >= maxY) return;
+
+		// Edge functions a * x + b * y + c, non-negative inside
+		const float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = -(a0 * v1.x + b0 * v1.y);
+		const float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = -(a1 * v2.x + b1 * v2.y);
+		const float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = -(a2 * v0.x + b2 * v0.y);
+
+		// Post-projection depth is linear in screen space
+		const float inverseArea = 1.f / area;
+		const float za = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * inverseArea;
+		const float zb = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * inverseArea;
+		const float zc = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * inverseArea;
+
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+		const __m128 laneCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 edgeA0 = _mm_set1_ps(a0);
+		const __m128 edgeA1 = _mm_set1_ps(a1);
+		const __m128 edgeA2 = _mm_set1_ps(a2);
+		const __m128 depthA = _mm_set1_ps(za);
+
+		// Four pixels per step, WIDTH is a multiple of four so aligning the start down never leaves the row
+		const int startX = minX & ~3;
+		for (int y = minY; y < maxY; ++y)
+		{
+			const float pixelY = y + 0.5f;
+			const __m128 rowEdge0 = _mm_set1_ps(b0 * pixelY + c0);
+			const __m128 rowEdge1 = _mm_set1_ps(b1 * pixelY + c1);
+			const __m128 rowEdge2 = _mm_set1_ps(b2 * pixelY + c2);
+			const __m128 rowDepth = _mm_set1_ps(zb * pixelY + zc);
+
+			float* pRow = &m_Depth[y * WIDTH];
+			for (int x = startX; x < maxX; x += 4)
+			{
+				const __m128 pixelX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneCenters);
+
+				const __m128 edge0 = _mm_add_ps(_mm_mul_ps(edgeA0, pixelX), rowEdge0);
+				const __m128 edge1 = _mm_add_ps(_mm_mul_ps(edgeA1, pixelX), rowEdge1);
+				const __m128 edge2 = _mm_add_ps(_mm_mul_ps(edgeA2, pixelX), rowEdge2);
+				const __m128 inside = _mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_and_ps(_mm_cmpge_ps(edge1, zero), _mm_cmpge_ps(edge2, zero)));
+				if (_mm_movemask_ps(inside) == 0) continue;
+
+				const __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, pixelX), rowDepth);
+				const __m128 stored = _mm_loadu_ps(pRow + x);
+				const __m128 nearest = _mm_min_ps(stored, depth);
+				_mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+			}
+		}
+#else
+		for (int y = minY; y < maxY; ++y)
+		{
+			const float pixelY = y + 0.5f;
+			float* pRow = &m_Depth[y * WIDTH];
+			for (int x = minX; x < maxX; ++x)
+			{
+				const float pixelX = x + 0.5f;
+				if (a0 * pixelX + (b0 * pixelY + c0) < 0.f || a1 * pixelX + (b1 * pixelY + c1) < 0.f || a2 * pixelX + (b2 * pixelY + c2) < 0.f) continue;
+				pRow[x] = std::min(pRow[x], za * pixelX + (zb * pixelY + zc));
+			}
+		}
+#endif
+	}
+
+	bool OcclusionBuffer::IsBoxOccluded(const BoundingBox& worldBox) const
+	{
+		float minX{ FLT_MAX };
+		float minY{ FLT_MAX };
+		float maxX{ -FLT_MAX };
+		float maxY{ -FLT_MAX };
+		float nearestDepth{ FLT_MAX };
+
+		for (int corner{ 0 }; corner < 8; ++corner)
+		{
+			const Vector4 clip = m_ViewProjection.TransformPoint(Vector4{
+				(corner & 1) ? worldBox.max.x : worldBox.min.x,
+				(corner & 2) ? worldBox.max.y : worldBox.min.y,
+				(corner & 4) ? worldBox.max.z : worldBox.min.z,
+				1.f });
+
+			// A box reaching through the near plane surrounds the camera
+			if (IsNearerThanNearPlane(clip, m_IsReversedZ)) return false;
+
+			const Vector4 point = ToOcclusionSpace(clip, m_IsReversedZ);
+			minX = std::min(minX, point.x);
+			minY = std::min(minY, point.y);
+			maxX = std::max(maxX, point.x);
+			maxY = std::max(maxY, point.y);
+			nearestDepth = std::min(nearestDepth, point.z);
+		}
+
+		const int firstX = ClampToPixel(std::floor(minX), WIDTH);
+		const int lastX = ClampToPixel(std::ceil(maxX), WIDTH);
+		const int firstY = ClampToPixel(std::floor(minY), HEIGHT);
+		const int lastY = ClampToPixel(std::ceil(maxY), HEIGHT);
+		if (firstX >= lastX || firstY >= lastY) return false;
+
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+		const __m128 laneIndices = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+		const __m128 first = _mm_set1_ps(static_cast<float>(firstX));
+		const __m128 last = _mm_set1_ps(static_cast<float>(lastX));
+		const __m128 boxDepth = _mm_set1_ps(nearestDepth);
+
+		for (int y = firstY; y < lastY; ++y)
+		{
+			const float* pRow = &m_Depth[y * WIDTH];
+			for (int x = firstX & ~3; x < lastX; x += 4)
+			{
+				const __m128 lane = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneIndices);
+				const __m128 inRange = _mm_and_ps(_mm_cmpge_ps(lane, first), _mm_cmplt_ps(lane, last));
+
+				// Any pixel at or behind the box leaves part of it potentially visible
+				const __m128 notNearer = _mm_cmpge_ps(_mm_loadu_ps(pRow + x), boxDepth);
+				if (_mm_movemask_ps(_mm_and_ps(inRange, notNearer)) != 0) return false;
+			}
+		}
+#else
+		for (int y = firstY; y < lastY; ++y)
+		{
+			const float* pRow = &m_Depth[y * WIDTH];
+			for (int x = firstX; x < lastX; ++x)
+			{
+				if (pRow[x] >= nearestDepth) return false;
+			}
+		}
+#endif
+		return true;
+	}
+
+	void OcclusionBuffer::StoreHistory(const DepthBuffer& depthBuffer, int width, int height, const Matrix& viewProjection, ThreadPool& threadPool)
+	{
+		threadPool.ParallelFor(HEIGHT, [&](int y, int)
+		{
+			const int firstRow = y * height / HEIGHT;
+			const int lastRow = std::max(firstRow + 1, ((y + 1) * height + HEIGHT - 1) / HEIGHT);
+			for (int x = 0; x < WIDTH; ++x)
+			{
+				const int firstColumn = x * width / WIDTH;
+				const int lastColumn = std::max(firstColumn + 1, ((x + 1) * width + WIDTH - 1) / WIDTH);
+
+				// Farthest depth of every full resolution pixel the coarse pixel overlaps
+				m_HistoryDepth[y * WIDTH + x] = depthBuffer.GetFarthest(firstColumn, firstRow, lastColumn - firstColumn, lastRow - firstRow);
+			}
+		});
+
+		m_HistoryInverseViewProjection = Matrix::Inverse(viewProjection);
+		m_HasHistory = true;
+	}
+
+	void OcclusionBuffer::ReprojectHistory()
+	{
+		// Negative marks pixels nothing lands on, they end up empty
+		std::fill(m_Depth.begin(), m_Depth.end(), -1.f);
+
+		for (int y = 0; y < HEIGHT; ++y)
+		{
+			for (int x = 0; x < WIDTH; ++x)
+			{
+				const float depth = m_HistoryDepth[y * WIDTH + x];
+				if (depth > 1.f) continue;
+
+				// The whole square of the coarse pixel at its farthest depth, so the new view has no gaps inside a surface.
+				// It covers the bounding box of its reprojected corners, at the farthest of their depths.
+				float minX{ FLT_MAX };
+				float minY{ FLT_MAX };
+				float maxX{ -FLT_MAX };
+				float maxY{ -FLT_MAX };
+				float farthestDepth{ -FLT_MAX };
+				bool isBehindCamera{ false };
+				for (int corner{ 0 }; corner < 4; ++corner)
+				{
+					// Back to world space through the previous frame's view projection
+					const float cornerX = static_cast<float>(x + (corner & 1));
+					const float cornerY = static_cast<float>(y + (corner >> 1));
+					const Vector4 previous = m_HistoryInverseViewProjection.TransformPoint(
+						cornerX / WIDTH * 2.f - 1.f, 1.f - cornerY / HEIGHT * 2.f, depth, 1.f);
+					const Vector3 worldPosition = Vector3{ previous.x, previous.y, previous.z } / previous.w;
+
+					const Vector4 clip = m_ViewProjection.TransformPoint(Vector4{ worldPosition, 1.f });
+					if (IsNearerThanNearPlane(clip, m_IsReversedZ))
+					{
+						isBehindCamera = true;
+						break;
+					}
+
+					const Vector4 point = ToOcclusionSpace(clip, m_IsReversedZ);
+					minX = std::min(minX, point.x);
+					minY = std::min(minY, point.y);
+					maxX = std::max(maxX, point.x);
+					maxY = std::max(maxY, point.y);
+					farthestDepth = std::max(farthestDepth, point.z);
+				}
+				if (isBehindCamera) continue;
+
+				// Pixels whose centre the box covers, rounding out would close the holes of disocclusions.
+				// Several squares can land on one pixel, keeping the farthest stays conservative.
+				const int firstX = ClampToPixel(std::ceil(minX - 0.5f), WIDTH);
+				const int lastX = ClampToPixel(std::floor(maxX - 0.5f) + 1.f, WIDTH);
+				const int firstY = ClampToPixel(std::ceil(minY - 0.5f), HEIGHT);
+				const int lastY = ClampToPixel(std::floor(maxY - 0.5f) + 1.f, HEIGHT);
+				for (int targetY = firstY; targetY < lastY; ++targetY)
+				{
+					for (int targetX = firstX; targetX < lastX; ++targetX)
+					{
+						float& target = m_Depth[targetY * WIDTH + targetX];
+						target = std::max(target, farthestDepth);
+					}
+				}
+			}
+		}
+
+		for (float& depth : m_Depth)
+		{
+			if (depth < 0.f) depth = EMPTY_DEPTH;
+		}
+
+		// A pixel at the edge of a disocclusion may be covered at its centre only.
+		// Every pixel takes the farthest depth of its 3x3 neighbourhood, which reaches past the edge to the hole or the farther surface behind it.
+		for (int y = 0; y < HEIGHT; ++y)
+		{
+			const float* pRow = &m_Depth[y * WIDTH];
+			float* pFiltered = &m_FilteredDepth[y * WIDTH];
+			for (int x = 0; x < WIDTH; ++x)
+			{
+				pFiltered[x] = std::max({ pRow[std::max(x - 1, 0)], pRow[x], pRow[std::min(x + 1, WIDTH - 1)] });
+			}
+		}
+		for (int y = 0; y < HEIGHT; ++y)
+		{
+			const float* pAbove = &m_FilteredDepth[std::max(y - 1, 0) * WIDTH];
+			const float* pRow = &m_FilteredDepth[y * WIDTH];
+			const float* pBelow = &m_FilteredDepth[std::min(y + 1, HEIGHT - 1) * WIDTH];
+			float* pTarget = &m_Depth[y * WIDTH];
+			for (int x = 0; x < WIDTH; ++x)
+			{
+				pTarget[x] = std::max({ pAbove[x], pRow[x], pBelow[x] });
+			}
+		}
+	}
+}
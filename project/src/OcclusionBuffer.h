@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Maths.h"
+#include "DataTypes.h"
+#include "DepthBuffer.h"
+#include "ThreadPool.h"
+
+namespace dae
+{
+	// Coarse depth-only buffer for occlusion culling.
+	// Occluders are rasterized four pixels at a time, instance boxes are tested against the result.
+	// Depth is the same post-projection z the full resolution depth buffer stores, mirrored back to 0 at the near plane with reversed-Z.
+	class OcclusionBuffer final
+	{
+	public:
+		static constexpr int WIDTH{ 256 };
+		static constexpr int HEIGHT{ 128 };
+
+		OcclusionBuffer();
+
+		// Starts a frame, either empty or seeded with the previous frame's depth reprojected to the new view.
+		// Returns true when the history was reprojected.
+		bool BeginFrame(const Matrix& viewProjection, bool isReversedZ, bool isHistoryValid);
+		// Vertices move against their normal by shrinkPerDepth object space units per unit of view depth,
+		// at least a pixel keeps sampling at pixel centres conservative
+		void RasterizeOccluder(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const Matrix& worldViewProjection,
+			float shrinkPerDepth);
+
+		// True when every pixel the box touches already holds something nearer than the box
+		bool IsBoxOccluded(const BoundingBox& worldBox) const;
+
+		// Keeps the farthest full resolution depth under each coarse pixel, reprojected next frame. Reads any depth format.
+		// viewProjection is the one the depth was rendered with, not necessarily the last BeginFrame's,
+		// width and height the part of the buffer it was rendered to, at the top left.
+		void StoreHistory(const DepthBuffer& depthBuffer, int width, int height, const Matrix& viewProjection, ThreadPool& threadPool);
+
+	private:
+		void RasterizeTriangle(const Vector4& v0, const Vector4& v1, const Vector4& v2);
+		void ReprojectHistory();
+
+		std::vector<float> m_Depth;
+		std::vector<float> m_HistoryDepth;
+		// Reprojection scratch, the rows' neighbourhood before the columns'
+		std::vector<float> m_FilteredDepth;
+
+		Matrix m_ViewProjection{};
+		bool m_IsReversedZ{};
+		Matrix m_HistoryInverseViewProjection{};
+		bool m_HasHistory{};
+	};
+}
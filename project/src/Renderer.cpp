@@ -2,17 +2,22 @@
 #include "SDL.h"
 #include "SDL_surface.h"
 #include <memory>
-#include <omp.h>
 #include <algorithm>
+#include <chrono>
 #include <limits>
 #include <vector>
 #include <cmath>
+#include <type_traits>
 
 // Project includes
 #include "Renderer.h"
 #include "Maths.h"
 #include "Texture.h"
 #include "Utils.h"
+#include "Frustum.h"
+#include "Scene.h"
+#include "Simd.h"
+#include "StreamStore.h"
 
 using namespace dae;
 
@@ -22,40 +27,161 @@ Renderer::Renderer(SDL_Window* pWindow) :
     // Initialize
     SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
 
-    m_DiffuseTexture = Texture::LoadFromFile("resources/vehicle_diffuse.png");
-    m_GlossTexture = Texture::LoadFromFile("resources/vehicle_gloss.png");
-    m_NormalMapTexture = Texture::LoadFromFile("resources/vehicle_normal.png");
-    m_SpecularTexture = Texture::LoadFromFile("resources/vehicle_specular.png");
-    //m_Texture = Texture::LoadFromFile("resources/jinx.png");
-
     // Create Buffers
-    m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
-    m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
-    m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+    Initialize();
+}
 
-    m_pDepthBufferPixels = new float[m_Width * m_Height];
+Renderer::Renderer(int width, int height) :
+    m_Width(width),
+    m_Height(height)
+{
+    // Headless, frames stay in the back buffer
+    Initialize();
+}
 
-    //auto& meshRef = m_MeshesWorld.emplace_back();
-    Mesh meshRef{};
-    Utils::ParseOBJ("resources/vehicle.obj", meshRef.vertices, meshRef.indices);
-  
-    meshRef.primitiveTopology = PrimitiveTopology::TriangleList;
-    m_MeshesWorld.emplace_back(meshRef);
+Renderer::~Renderer() = default;
+
+void Renderer::Initialize()
+{
+    const size_t pixelCount = static_cast<size_t>(m_Width) * m_Height;
+    for (FrameContext& frame : m_Frames) {
+        frame.depthBuffer = DepthBuffer{ m_Width, m_Height, m_DepthFormat, m_Camera.isReversedZ };
+        frame.triangleKeys.resize(pixelCount, EMPTY_TRIANGLE_KEY);
+        frame.colorAges.resize(pixelCount);
+    }
+    m_VisibilityBuffer.resize(pixelCount, EMPTY_VISIBILITY);
+    m_pFramebuffer = std::make_unique<Framebuffer>(m_Width, m_Height);
+    m_ScaledPixels.resize(pixelCount);
+
+    // A cleared image is presented up front, so there is a last presented frame before the first Render
+    m_pSwapChain = std::make_unique<SwapChain>(m_pWindow, m_Width, m_Height);
+    m_pBackBuffer = m_pSwapChain->Acquire();
+    m_pBackBufferPixels = static_cast<uint32_t*>(m_pBackBuffer->pixels);
+    m_pDepthBuffer = &m_Frames[m_DisplayFrame].depthBuffer;
+    ClearBuffers();
+    m_pSwapChain->Present(m_pBackBuffer);
+
+    m_pScene = std::make_unique<Scene>();
+    LoadScene(SceneType::Vehicle);
 
     // Initialize Camera
     m_Camera.Initialize(m_Width, m_Height, 45.f, { 0.f, 5.f, -64.f });
 
-    // Number of threads for OpenMP
-    omp_set_num_threads(omp_get_max_threads());
+    // Tiles cover the screen, the ones on the right and bottom edge may be partial
+    m_TileCountX = (m_Width + TILE_SIZE - 1) / TILE_SIZE;
+    m_TileCountY = (m_Height + TILE_SIZE - 1) / TILE_SIZE;
+
+    const size_t workerCount = static_cast<size_t>(m_ThreadPool.GetWorkerCount());
+    const size_t tileCount = static_cast<size_t>(m_TileCountX) * m_TileCountY;
+    for (FrameContext& frame : m_Frames) {
+        frame.tileBins.resize(workerCount * tileCount);
+        frame.workerCounters.resize(workerCount);
+        frame.isTileDepthCleared.resize(tileCount, true);
+    }
+    m_IsTileVisibilityCleared.resize(tileCount, true);
+    m_TileContrast.resize(tileCount);
+    m_TileTriangles.resize(workerCount);
+    m_UpscaleRows.resize(workerCount, std::vector<int16_t>(4 * (static_cast<size_t>(m_Width) + 1)));
 }
 
-Renderer::~Renderer()
+void Renderer::LoadScene(SceneType sceneType)
 {
-    delete[] m_pDepthBufferPixels;
-    delete m_DiffuseTexture;
-    delete m_GlossTexture;
-    delete m_NormalMapTexture;
-    delete m_SpecularTexture;
+    m_CurrentScene = sceneType;
+    m_pScene->Clear();
+    ++m_SceneVersion;
+    // A prepared frame points into the old meshes, triangle keys name the old instances
+    m_IsFramePrepared = false;
+    for (FrameContext& frame : m_Frames) {
+        frame.hasHistory = false;
+    }
+
+    switch (sceneType)
+    {
+    case SceneType::Vehicle:
+    {
+        // The mesh is parsed once and shared by every instance
+        const uint32_t vehicleMesh = m_pScene->LoadMesh("resources/vehicle.obj");
+        const uint32_t vehicleMaterial = m_pScene->AddMaterial("resources/vehicle_diffuse.png", "resources/vehicle_normal.png",
+            "resources/vehicle_gloss.png", "resources/vehicle_specular.png");
+
+        m_pScene->AddInstance(vehicleMesh, vehicleMaterial, Matrix{});
+        break;
+    }
+    case SceneType::VehicleGrid:
+    {
+        const uint32_t vehicleMesh = m_pScene->LoadMesh("resources/vehicle.obj");
+        const uint32_t vehicleMaterial = m_pScene->AddMaterial("resources/vehicle_diffuse.png", "resources/vehicle_normal.png",
+            "resources/vehicle_gloss.png", "resources/vehicle_specular.png");
+
+        // Rows run away from the camera, most of the grid ends up outside the frustum
+        constexpr int columns{ 40 };
+        constexpr int rows{ 25 };
+        constexpr float spacing{ 50.f };
+        for (int row{ 0 }; row < rows; ++row)
+        {
+            for (int column{ 0 }; column < columns; ++column)
+            {
+                m_pScene->AddInstance(vehicleMesh, vehicleMaterial,
+                    Matrix::CreateTranslation((column - (columns - 1) * 0.5f) * spacing, 0.f, row * spacing));
+            }
+        }
+        break;
+    }
+    case SceneType::JinxCrowd:
+    {
+        // Small, dense figures at increasing distance, most of them end up on a coarse level of detail
+        const uint32_t jinxMesh = m_pScene->LoadMesh("resources/jinx.obj");
+        const uint32_t jinxMaterial = m_pScene->AddMaterial("resources/uv_grid_2.png", "", "", "");
+
+        constexpr int columns{ 20 };
+        constexpr int rows{ 20 };
+        constexpr float spacing{ 2.5f };
+        for (int row{ 0 }; row < rows; ++row)
+        {
+            for (int column{ 0 }; column < columns; ++column)
+            {
+                m_pScene->AddInstance(jinxMesh, jinxMaterial,
+                    Matrix::CreateScale(4.f, 4.f, 4.f) * Matrix::CreateTranslation((column - (columns - 1) * 0.5f) * spacing * 4.f, 0.f, -50.f + row * spacing * 4.f));
+            }
+        }
+        break;
+    }
+    case SceneType::ParkingLot:
+    {
+        // A row of vehicles close to the camera hides most of the small cars parked behind it
+        const uint32_t vehicleMesh = m_pScene->LoadMesh("resources/vehicle.obj");
+        const uint32_t vehicleMaterial = m_pScene->AddMaterial("resources/vehicle_diffuse.png", "resources/vehicle_normal.png",
+            "resources/vehicle_gloss.png", "resources/vehicle_specular.png");
+        const uint32_t carMesh = m_pScene->LoadMesh("resources/mazda.obj");
+        const uint32_t carMaterial = m_pScene->AddMaterial("resources/mazda.png", "", "", "");
+
+        for (int lane{ -1 }; lane <= 1; ++lane)
+        {
+            m_pScene->AddInstance(vehicleMesh, vehicleMaterial, Matrix::CreateTranslation(lane * 40.f, 0.f, -30.f));
+        }
+
+        constexpr int columns{ 16 };
+        constexpr int rows{ 8 };
+        for (int row{ 0 }; row < rows; ++row)
+        {
+            for (int column{ 0 }; column < columns; ++column)
+            {
+                m_pScene->AddInstance(carMesh, carMaterial,
+                    Matrix::CreateTranslation((column - (columns - 1) * 0.5f) * 8.f, -8.f, row * 10.f));
+            }
+        }
+        break;
+    }
+    case SceneType::TukTuk:
+    {
+        // Single diffuse-only model, scaled up and lowered so it fills the view like the vehicle
+        const uint32_t tuktukMesh = m_pScene->LoadMesh("resources/tuktuk.obj");
+        const uint32_t tuktukMaterial = m_pScene->AddMaterial("resources/tuktuk.png", "", "", "");
+
+        m_pScene->AddInstance(tuktukMesh, tuktukMaterial, Matrix::CreateScale(3.f, 3.f, 3.f) * Matrix::CreateTranslation(0.f, -12.f, 0.f));
+        break;
+    }
+    }
 }
 
 void Renderer::Update(Timer* pTimer)
@@ -63,260 +189,1353 @@ void Renderer::Update(Timer* pTimer)
 
     m_Camera.Update(pTimer);
 
-
     if (m_IsRotating)
     {
        
         m_MatrixRot *= Matrix::CreateRotationY(pTimer->GetElapsed());
+
+        // Last frame's depth no longer matches the moved instances
+        ++m_SceneVersion;
     }
    
 }
 
+void Renderer::ClearBuffers()
+{
+    // Reset depth buffer and clear screen, the float colors are only read in tiles that filled them first
+    m_pDepthBuffer->Clear(0, 0, m_Width, m_Height, true);
+
+    // Clear screen with gray color
+    StreamFill(m_pBackBufferPixels, m_Width, 0, 0, m_Width, m_Height, Framebuffer::Pack(CLEAR_COLOR));
+}
+
+void Renderer::SetDepthFormat(DepthFormat depthFormat)
+{
+    m_DepthFormat = depthFormat;
+    RecreateDepthBuffers();
+}
+
+void Renderer::SetIsReversedZ(bool isReversedZ)
+{
+    m_Camera.isReversedZ = isReversedZ;
+    m_Camera.isProjectionMatrixDirty = true;
+    m_Camera.CalculateProjectionMatrix();
+    RecreateDepthBuffers();
+
+    // Geometry already prepared was projected the other way around
+    m_IsFramePrepared = false;
+}
+
+void Renderer::SetIsInfiniteFar(bool isInfiniteFar)
+{
+    m_Camera.isInfiniteFar = isInfiniteFar;
+    m_Camera.isProjectionMatrixDirty = true;
+    m_Camera.CalculateProjectionMatrix();
+
+    // Geometry already prepared was projected and culled against the other far plane
+    m_IsFramePrepared = false;
+}
+
+void Renderer::SetRenderScale(float renderScale)
+{
+    m_RenderScale = std::clamp(renderScale, .01f, 1.f);
+    if (m_IsDynamicResolution) m_DynamicResolution.Reset(m_RenderScale);
+}
+
+void Renderer::SetIsMsaa(bool isMsaa)
+{
+    m_IsMsaa = isMsaa;
+    if (!isMsaa) {
+        m_SampleDepthBuffer = DepthBuffer{};
+        m_pSampleFramebuffer.reset();
+        return;
+    }
+    if (!m_pSampleFramebuffer) m_pSampleFramebuffer = std::make_unique<Framebuffer>(m_Width * MSAA_SAMPLES, m_Height);
+    m_SampleDepthBuffer = DepthBuffer{ m_Width * MSAA_SAMPLES, m_Height, m_DepthFormat, m_Camera.isReversedZ };
+}
+
+size_t Renderer::GetRenderTargetBytes() const
+{
+    size_t bytes = m_pFramebuffer->GetByteSize() + m_VisibilityBuffer.size() * sizeof(uint32_t) + m_SampleDepthBuffer.GetByteSize();
+    for (const FrameContext& frame : m_Frames) {
+        bytes += frame.depthBuffer.GetByteSize();
+    }
+    if (m_pSampleFramebuffer) bytes += m_pSampleFramebuffer->GetByteSize();
+    return bytes;
+}
+
+void Renderer::RecreateDepthBuffers()
+{
+    for (FrameContext& frame : m_Frames) {
+        frame.depthBuffer = DepthBuffer{ m_Width, m_Height, m_DepthFormat, m_Camera.isReversedZ };
+        std::fill(frame.isTileDepthCleared.begin(), frame.isTileDepthCleared.end(), uint8_t{ true });
+    }
+    if (m_IsMsaa) m_SampleDepthBuffer = DepthBuffer{ m_Width * MSAA_SAMPLES, m_Height, m_DepthFormat, m_Camera.isReversedZ };
+}
+
+Renderer::FrameState Renderer::CaptureFrameState() const
+{
+    FrameState state{};
+    state.viewProjection = m_Camera.viewMatrix * m_Camera.projectionMatrix;
+    state.sceneVersion = m_SceneVersion;
+    state.renderScale = GetRenderScale();
+    state.displayMode = m_CurrentDisplayMode;
+    state.shadingMode = m_CurrentShadingMode;
+    state.renderPath = m_CurrentRenderPath;
+    state.shadingRate = m_ShadingRate;
+    state.depthFormat = m_DepthFormat;
+    state.isReversedZ = m_Camera.isReversedZ;
+    state.isNormalMap = m_IsNormalMap;
+    state.isLodEnabled = m_IsLodEnabled;
+    state.isDepthSorted = m_IsDepthSorted;
+    state.isReprojectionCache = m_IsReprojectionCache;
+    state.isMsaa = m_IsMsaa;
+    return state;
+}
+
+bool Renderer::IsHistoryReusable(const FrameContext& previous, const FrameState& previousState, const FrameState& state) const
+{
+    // Camera and instances may have moved, anything else that changes the shading or the depth texels starts over
+    return state.isReprojectionCache && state.renderPath == RenderPath::VisibilityBuffer && previous.hasHistory
+        && previousState.displayMode == state.displayMode && previousState.shadingMode == state.shadingMode
+        && previousState.isNormalMap == state.isNormalMap && previousState.depthFormat == state.depthFormat
+        && previousState.isReversedZ == state.isReversedZ;
+}
+
+bool Renderer::IsFrameDirty() const
+{
+    // The frame on screen was prepared and shaded in this state, and so was the one presented next
+    const FrameState state = CaptureFrameState();
+    return state != m_RenderedState || state != m_Frames[m_DisplayFrame].state
+        || (m_IsPipelined && m_IsFramePrepared && state != m_Frames[1 - m_DisplayFrame].state);
+}
+
 void Renderer::Render()
 {
-    // Reset depth buffer and clear screen
-    std::fill(m_pDepthBufferPixels, m_pDepthBufferPixels + (m_Width * m_Height), std::numeric_limits<float>::max());
+    // The image stays as it is
+    if (m_IsFrameSkipping && !IsFrameDirty()) {
+        ++m_SkippedFrameCount;
+        return;
+    }
+    const FrameState state = CaptureFrameState();
+
+    // Waits here in vsync mode while every other image is queued or on screen
+    SDL_Surface* pImage = m_pSwapChain->Acquire();
+
+    const auto callStart = std::chrono::steady_clock::now();
+    m_ThreadPool.ResetStats();
+    m_FrameGraph.Clear();
 
-    // Clear screen with black color
-    SDL_Color clearColor = { 100, 100, 100, 255 };
-    Uint32 color = SDL_MapRGB(m_pBackBuffer->format, clearColor.r, clearColor.g, clearColor.b);
-    SDL_FillRect(m_pBackBuffer, nullptr, color);
+    // The presented frame keeps its buffers until the other one replaces it on screen
+    const int rasterIndex = 1 - m_DisplayFrame;
+    FrameContext& rasterFrame = m_Frames[rasterIndex];
+    FrameContext& nextFrame = m_Frames[m_DisplayFrame];
+
+    // Without geometry prepared by the last call, this frame's is processed first
+    TaskGraph::JobId geometryJob = NO_JOB;
+    if (!m_IsPipelined || !m_IsFramePrepared) {
+        rasterFrame.startTime = callStart;
+        geometryJob = AddGeometryJobs(rasterFrame, NO_JOB);
+    }
+    AddRasterJobs(rasterFrame, geometryJob);
+
+    // The next frame is culled, sorted, transformed and binned while this one's tiles rasterize,
+    // after this frame's own geometry if there is any since both use the culling and sort scratch
+    if (m_IsPipelined) {
+        nextFrame.startTime = callStart;
+        AddGeometryJobs(nextFrame, geometryJob);
+    }
+
+    // The presented image and its frame's keys are left alone until this one replaces them, its matrices are copied
+    // since the next frame's geometry overwrites them while the tiles resolve
+    const FrameContext& previousFrame = m_Frames[m_DisplayFrame];
+    m_pHistoryFrame = IsHistoryReusable(previousFrame, m_RenderedState, state) ? &previousFrame : nullptr;
+    m_HistoryView = previousFrame.view;
+    m_HistoryProjection = previousFrame.projection;
+    m_HistoryRotation = previousFrame.rotation;
+    m_pHistoryPixels = m_pBackBufferPixels;
+    m_RenderedState = state;
+
+    m_pBackBuffer = pImage;
+    m_pBackBufferPixels = static_cast<uint32_t*>(m_pBackBuffer->pixels);
+    m_pDepthBuffer = &rasterFrame.depthBuffer;
 
     // Lock the back buffer before drawing
     SDL_LockSurface(m_pBackBuffer);
 
     // RENDER LOGIC
-    for (Mesh& mesh : m_MeshesWorld) {
-        // Apply transformations
-        VertexTransformationFunction(mesh);
-
-        bool isTriangleList = (mesh.primitiveTopology == PrimitiveTopology::TriangleList);
-
-        // Parallelize over triangles
-#pragma omp parallel for
-        for (int inx = 0; inx < mesh.indices.size(); inx += (isTriangleList ? 3 : 1)) {
-            
-            auto t0 = mesh.indices[inx];
-            auto t1 = mesh.indices[inx + 1];
-            auto t2 = mesh.indices[inx + 2];
-
-            ////Perform clipping 
-            //std::vector<Vertex_Out> clippedVertices;
-            //std::vector<uint32_t> clippedIndices;
-            //ClipTriangle(mesh.vertices_out[t0], mesh.vertices_out[t1], mesh.vertices_out[t2], clippedVertices, clippedIndices);
-            //
-            //if (clippedVertices.size() < 3) continue; // If there are not enough vertices left after clipping, skip this triangle
-
-            // Skip degenerate triangles
-            if (t0 == t1 || t1 == t2 || t2 == t0) continue;
-
-            // Vertex positions
-            auto v0 = mesh.vertices_out[t0].position;
-            auto v1 = mesh.vertices_out[t1].position;
-            auto v2 = mesh.vertices_out[t2].position;
-
-            // Skip if any vertex is behind the camera (w < 0)
-            if (v0.w < 0 || v1.w < 0 || v2.w < 0) continue;
-            
-            if ((v0.x < -1  || v0.x > 1) || (v1.x < -1 || v1.x > 1) || (v2.x < -1 || v2.x > 1)
-                || ((v0.y < -1 || v0.y > 1) || (v1.y < -1 || v1.y > 1) || (v2.y < -1 || v2.y > 1))
-                || ((v0.z < 0 || v0.z > 1) || (v1.z < 0 || v1.z > 1) || (v2.z < 0 || v2.z > 1))) continue;
-
-
-            // Backface culling (skip if the triangle is facing away from the camera)
-            Vector3 edge0 = v1 - v0;
-            Vector3 edge1 = v2 - v0;
-            Vector3 normal = Vector3::Cross(edge0, edge1);
-            if (normal.z <= 0) continue;
-           
-
-            // Transform coordinates to screen space
-            v0.x *= m_Width;
-            v1.x *= m_Width;
-            v2.x *= m_Width;
-            v0.y *= m_Height;
-            v1.y *= m_Height;
-            v2.y *= m_Height;
-
-            // Compute bounding box of the triangle
-            int minX = std::max(0, static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))));
-            int maxX = std::min(m_Width, static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))));
-            int minY = std::max(0, static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))));
-            int maxY = std::min(m_Height, static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))));
-
-            // Edge vectors for barycentric coordinates
-            auto e0 = v2 - v1;
-            auto e1 = v0 - v2;
-            auto e2 = v1 - v0;
-
-            Vector2 edge0_2D(e0.x, e0.y);
-            Vector2 edge1_2D(e1.x, e1.y);
-            Vector2 edge2_2D(e2.x, e2.y);
-
-            float wProduct = v0.w * v1.w * v2.w;
-
-            
-
-// Parallelize over rows of pixels (py)
-#pragma omp parallel for
-            for (int py = minY; py < maxY; ++py) {
-                for (int px = minX; px < maxX; ++px) {
-                    ColorRGB finalColor;
-                    auto P = Vector2(px + 0.5f, py + 0.5f);
-
-                    auto p0 = P - Vector2(v1.x, v1.y);
-                    auto p1 = P - Vector2(v2.x, v2.y);
-                    auto p2 = P - Vector2(v0.x, v0.y);
-
-                    auto weightP0 = Vector2::Cross(edge0_2D, p0);
-                    auto weightP1 = Vector2::Cross(edge1_2D, p1);
-                    auto weightP2 = Vector2::Cross(edge2_2D, p2);
-
-                    if (weightP0 < 0 || weightP1 < 0 || weightP2 < 0) continue;
-
-                    auto totalArea = weightP0 + weightP1 + weightP2;
-                    float reciprocalTotalArea = 1.0f / totalArea;
-
-                    float interpolationScale0 = weightP0 * reciprocalTotalArea;
-                    float interpolationScale1 = weightP1 * reciprocalTotalArea;
-                    float interpolationScale2 = weightP2 * reciprocalTotalArea;
-
-                    // Compute z-buffer value for depth testing
-                    float zBufferValue = 1.f / (1.f / v0.z * interpolationScale0 +
-                        1.f / v1.z * interpolationScale1 +
-                        1.f / v2.z * interpolationScale2);
-
-                    if (zBufferValue < 0 || zBufferValue > 1) continue;
-
-        
+    m_ThreadPool.Run(m_FrameGraph);
+    m_IsFramePrepared = m_IsPipelined;
+    rasterFrame.hasHistory = state.isReprojectionCache && state.renderPath == RenderPath::VisibilityBuffer && !IsUpscaled(rasterFrame);
+
+    FrameStats& frameStats = rasterFrame.stats;
+    frameStats.meshletsCulled = 0;
+    frameStats.trianglesRasterized = 0;
+    frameStats.pixelsShaded = 0;
+    frameStats.fragmentsRejected = 0;
+    frameStats.pixelsBroadcast = 0;
+    frameStats.pixelsReprojected = 0;
+    frameStats.pixelsReused = 0;
+    std::fill(std::begin(frameStats.tilesPerShadingRate), std::end(frameStats.tilesPerShadingRate), 0);
+    for (const WorkerCounters& counters : rasterFrame.workerCounters) {
+        frameStats.meshletsCulled += counters.meshletsCulled;
+        frameStats.trianglesRasterized += counters.trianglesRasterized;
+        frameStats.pixelsShaded += counters.pixelsShaded;
+        frameStats.fragmentsRejected += counters.fragmentsRejected;
+        frameStats.pixelsBroadcast += counters.pixelsBroadcast;
+        frameStats.pixelsReprojected += counters.pixelsReprojected;
+        frameStats.pixelsReused += counters.pixelsReused;
+        for (size_t rate = 0; rate < std::size(frameStats.tilesPerShadingRate); ++rate) {
+            frameStats.tilesPerShadingRate[rate] += counters.tilesPerShadingRate[rate];
+        }
+        for (size_t lod = 0; lod < MAX_MESH_LODS; ++lod) {
+            frameStats.lodTriangles[lod] += counters.lodTriangles[lod];
+        }
+    }
 
-                    int pixelIndex = px + (py * m_Width);
-                    if (zBufferValue >= m_pDepthBufferPixels[pixelIndex]) continue;
-
-                    m_pDepthBufferPixels[pixelIndex] = zBufferValue;
-
-                    // Interpolated depth for final color calculation
-                    float interpolatedDepth = wProduct / (v1.w * v2.w * interpolationScale0 +
-                        v0.w * v2.w * interpolationScale1 +
-                        v0.w * v1.w * interpolationScale2);
-                    if (interpolatedDepth <= 0) continue;
+    // The finished depth buffer seeds the occlusion buffer of the next frame prepared with the same instances
+    if (m_IsOcclusionCulling) {
+        m_OcclusionBuffer.StoreHistory(*m_pDepthBuffer, rasterFrame.renderWidth, rasterFrame.renderHeight, rasterFrame.viewProjection, m_ThreadPool);
+        m_OcclusionHistoryVersion = rasterFrame.sceneVersion;
+        m_HasOcclusionHistory = true;
+    }
 
-                    // Texture sampling
-                    Vertex_Out pixelVertex;
+    // Unlock after rendering
+    SDL_UnlockSurface(m_pBackBuffer);
 
-                    pixelVertex.position = (mesh.vertices[t0].position.ToPoint4() + mesh.vertices[t1].position.ToPoint4() + mesh.vertices[t2].position.ToPoint4()) / 3.f;
-                    pixelVertex.position.z = zBufferValue;
-                    pixelVertex.position.w = interpolatedDepth;
-                    
+    // Shown right away when uncapped, otherwise the present thread hands it back at the next refresh while the next frame renders
+    m_pSwapChain->Present(m_pBackBuffer);
+    m_DisplayFrame = rasterIndex;
 
-                    pixelVertex.uv = Vector2::Interpolate(mesh.vertices_out[t0].uv, mesh.vertices_out[t1].uv, mesh.vertices_out[t2].uv,
-                        v0.w, v1.w, v2.w, interpolationScale0, interpolationScale1, interpolationScale2, interpolatedDepth, wProduct);
+    const auto presentTime = std::chrono::steady_clock::now();
+    frameStats.renderNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(presentTime - callStart).count();
+    frameStats.latencyNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(presentTime - rasterFrame.startTime).count();
 
-                    pixelVertex.normal = Vector3::Interpolate(mesh.vertices_out[t0].normal, mesh.vertices_out[t1].normal, mesh.vertices_out[t2].normal,
-                        v0.w, v1.w, v2.w, interpolationScale0, interpolationScale1, interpolationScale2, interpolatedDepth, wProduct);
-                    pixelVertex.normal.Normalize();
+    // The time rendering took picks the resolution of the frames rendered next. The wait in Acquire is left out,
+    // in vsync mode it stretches every frame to the refresh interval and would keep the scale from ever growing.
+    if (m_IsDynamicResolution) m_DynamicResolution.Update(frameStats.renderNanoseconds / 1e9f);
+}
 
+TaskGraph::JobId Renderer::AddGeometryJobs(FrameContext& frame, TaskGraph::JobId after)
+{
+    // Only the prepare task knows how many draws there are, it sizes every job after it
+    const int partCount = m_ThreadPool.GetWorkerCount();
+    const TaskGraph::JobId keysJob = m_FrameGraph.AddJob(0, [this, &frame](int chunk, int) { ComputeSortKeys(frame, chunk); });
+
+    std::array<TaskGraph::JobId, RADIX_PASSES * 3> radixJobs{};
+    TaskGraph::JobId previousJob = keysJob;
+    for (int pass = 0; pass < RADIX_PASSES; ++pass) {
+        radixJobs[pass * 3] = m_FrameGraph.AddJob(0, [this, pass](int part, int) { RadixHistogram(part, pass); });
+        radixJobs[pass * 3 + 1] = m_FrameGraph.AddJob(0, [this](int, int) { RadixPrefixSum(); });
+        radixJobs[pass * 3 + 2] = m_FrameGraph.AddJob(0, [this, &frame, pass](int part, int) { RadixScatter(frame, part, pass); });
+        for (int step = 0; step < 3; ++step) {
+            m_FrameGraph.AddDependency(previousJob, radixJobs[pass * 3 + step]);
+            previousJob = radixJobs[pass * 3 + step];
+        }
+    }
 
-                    pixelVertex.tangent = Vector3::Interpolate(mesh.vertices_out[t0].tangent, mesh.vertices_out[t1].tangent, mesh.vertices_out[t2].tangent,
-                        v0.w, v1.w, v2.w, interpolationScale0, interpolationScale1, interpolationScale2, interpolatedDepth, wProduct);
-                    pixelVertex.tangent.Normalize();
+    const TaskGraph::JobId transformJob = m_FrameGraph.AddJob(0, [this, &frame](int chunk, int worker) { TransformChunk(frame, chunk, worker); });
+    const TaskGraph::JobId binJob = m_FrameGraph.AddJob(0, [this, &frame](int chunk, int worker) { BinChunk(frame, chunk, worker); });
+    m_FrameGraph.AddDependency(previousJob, transformJob);
+    m_FrameGraph.AddDependency(transformJob, binJob);
+
+    const TaskGraph::JobId prepareJob = m_FrameGraph.AddJob(1, [this, &frame, partCount, keysJob, radixJobs, transformJob, binJob](int, int) {
+        PrepareFrame(frame);
+
+        // Near meshlets fill the depth buffer first so more fragments behind them are rejected before shading
+        const int drawCount = static_cast<int>(frame.meshletDraws.size());
+        const int chunkCount = (drawCount + DRAWS_PER_CHUNK - 1) / DRAWS_PER_CHUNK;
+        const bool isSorted = m_IsDepthSorted && drawCount > 1;
+        m_FrameGraph.SetTaskCount(keysJob, isSorted ? chunkCount : 0);
+        for (int pass = 0; pass < RADIX_PASSES; ++pass) {
+            m_FrameGraph.SetTaskCount(radixJobs[pass * 3], isSorted ? partCount : 0);
+            m_FrameGraph.SetTaskCount(radixJobs[pass * 3 + 1], isSorted ? 1 : 0);
+            m_FrameGraph.SetTaskCount(radixJobs[pass * 3 + 2], isSorted ? partCount : 0);
+        }
+        m_FrameGraph.SetTaskCount(transformJob, chunkCount);
+        m_FrameGraph.SetTaskCount(binJob, chunkCount);
+        });
+    m_FrameGraph.AddDependency(prepareJob, keysJob);
+    if (after != NO_JOB) m_FrameGraph.AddDependency(after, prepareJob);
 
-                    pixelVertex.viewDirection = Vector3::Interpolate(mesh.vertices_out[t0].viewDirection, mesh.vertices_out[t1].viewDirection, mesh.vertices_out[t2].viewDirection,
-                        v0.w, v1.w, v2.w, interpolationScale0, interpolationScale1, interpolationScale2, interpolatedDepth, wProduct);
-                    pixelVertex.viewDirection.Normalize();
+    return binJob;
+}
 
-                    pixelVertex.color = colors::Black;
+void Renderer::AddRasterJobs(FrameContext& frame, TaskGraph::JobId after)
+{
+    // Every tile is cleared, rasterized and resolved on its own
+    const int tileCount = m_TileCountX * m_TileCountY;
+    const TaskGraph::JobId rasterJob = m_FrameGraph.AddJob(tileCount, [this, &frame](int tile, int worker) { RasterizeTile(frame, tile, worker); });
+    if (after != NO_JOB) m_FrameGraph.AddDependency(after, rasterJob);
+
+    TaskGraph::JobId lastJob = rasterJob;
+    if (m_CurrentRenderPath == RenderPath::VisibilityBuffer) {
+        lastJob = m_FrameGraph.AddJob(tileCount, [this, &frame](int tile, int worker) { ResolveTile(frame, tile, worker); });
+        m_FrameGraph.AddDependency(rasterJob, lastJob);
+    }
 
-                    // If texture mapping is enabled, sample the texture
-                    if (m_CurrentDisplayMode == DisplayMode::FinalColor)
-                    {
-                        finalColor = m_DiffuseTexture->Sample(pixelVertex.uv);
-                    }
-                    if (m_CurrentDisplayMode == DisplayMode::DepthBuffer)
-                    {
-                        auto clampedValue = Remap(zBufferValue, 0.8f, 1.f, 0.f, 1.f);
-                        finalColor = ColorRGB(clampedValue, clampedValue, clampedValue);
-                    }
-                    if (m_CurrentDisplayMode == DisplayMode::ShadingMode)
-                    {
-                        PixelShading(pixelVertex);
-                        finalColor = pixelVertex.color;
-                    }
-                    
-                    finalColor.MaxToOne();
+    // The render extent may only be known once the frame's geometry job ran, bands of frames at full resolution return right away
+    const int bandCount = (m_Height + UPSCALE_ROWS - 1) / UPSCALE_ROWS;
+    const TaskGraph::JobId upscaleJob = m_FrameGraph.AddJob(bandCount, [this, &frame](int band, int worker) { UpscaleBand(frame, band, worker); });
+    m_FrameGraph.AddDependency(lastJob, upscaleJob);
+}
 
-                    m_pBackBufferPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
-                        static_cast<uint8_t>(finalColor.r * 255.f),
-                        static_cast<uint8_t>(finalColor.g * 255.f),
-                        static_cast<uint8_t>(finalColor.b * 255.f));
+void Renderer::PrepareFrame(FrameContext& frame)
+{
+    // Frustum planes in world space, instances are tested before any per-vertex work
+    frame.viewProjection = m_Camera.viewMatrix * m_Camera.projectionMatrix;
+    frame.view = m_Camera.viewMatrix;
+    frame.projection = m_Camera.projectionMatrix;
+    frame.rotation = m_MatrixRot;
+    frame.isReversedZ = m_Camera.isReversedZ;
+    frame.sceneVersion = m_SceneVersion;
+    frame.state = CaptureFrameState();
+
+    // Both axes scale alike, so the projection stays the same
+    const float renderScale = GetRenderScale();
+    frame.renderWidth = std::clamp(static_cast<int>(m_Width * renderScale + .5f), 1, m_Width);
+    frame.renderHeight = std::clamp(static_cast<int>(m_Height * renderScale + .5f), 1, m_Height);
+    frame.stats.renderScale = renderScale;
+    frame.stats.renderWidth = frame.renderWidth;
+    frame.stats.renderHeight = frame.renderHeight;
+    const Frustum frustum = Frustum::FromMatrix(frame.viewProjection);
+
+    const auto& meshes = m_pScene->GetMeshes();
+    const auto& instances = m_pScene->GetInstances();
+
+    FrameStats& frameStats = frame.stats;
+    frameStats.instancesTotal = static_cast<int>(instances.size());
+    for (size_t lod = 0; lod < MAX_MESH_LODS; ++lod) {
+        frameStats.lodInstances[lod] = 0;
+        frameStats.lodTriangles[lod] = 0;
+    }
+
+    // Batch the per-instance matrices of everything inside the frustum
+    frame.visibleInstances.clear();
+    for (uint32_t instanceIndex = 0; instanceIndex < instances.size(); ++instanceIndex) {
+        const MeshInstance& instance = instances[instanceIndex];
+        const Mesh& mesh = meshes[instance.meshIndex];
+
+        const Matrix rotatedWorldMatrix = m_MatrixRot * instance.worldMatrix;
+        if (!frustum.IsSphereVisible(mesh.boundingSphere.Transformed(rotatedWorldMatrix))
+            || !frustum.IsBoxVisible(mesh.boundingBox.Transformed(rotatedWorldMatrix))) continue;
+
+        const uint32_t lod = SelectLod(mesh, rotatedWorldMatrix);
+        frame.visibleInstances.push_back({ rotatedWorldMatrix, rotatedWorldMatrix * frame.viewProjection, instanceIndex, lod });
+    }
+    frameStats.instancesCulled = frameStats.instancesTotal - static_cast<int>(frame.visibleInstances.size());
+
+    frameStats.instancesOccluded = 0;
+    frameStats.occluders = 0;
+    frameStats.isOcclusionReprojected = false;
+    // A single instance has nothing to hide
+    if (m_IsOcclusionCulling && frame.visibleInstances.size() > 1) CullOccludedInstances(frame);
+
+    for (const VisibleInstance& visibleInstance : frame.visibleInstances) {
+        ++frameStats.lodInstances[visibleInstance.lod];
+    }
+
+    // Flatten the meshlets of all visible instances into one list of work items
+    frame.meshletDraws.clear();
+    uint32_t vertexCount = 0;
+    for (uint32_t visibleIndex = 0; visibleIndex < frame.visibleInstances.size(); ++visibleIndex) {
+        const Mesh& mesh = meshes[instances[frame.visibleInstances[visibleIndex].instanceIndex].meshIndex];
+        const MeshLod& lod = mesh.lods[frame.visibleInstances[visibleIndex].lod];
+        for (uint32_t meshletIndex = 0; meshletIndex < lod.meshlets.size(); ++meshletIndex) {
+            frame.meshletDraws.push_back({ visibleIndex, meshletIndex, vertexCount });
+            vertexCount += lod.meshlets[meshletIndex].vertexCount;
+        }
+    }
+    frameStats.meshletsTotal = static_cast<int>(frame.meshletDraws.size());
+
+    // Tiles read the vertices of any draw, so they are kept for the whole frame
+    const size_t drawCount = frame.meshletDraws.size();
+    if (frame.transformedVertices.size() < vertexCount) frame.transformedVertices.resize(vertexCount);
+    frame.isDrawCulled.resize(drawCount);
+    for (std::vector<uint32_t>& bin : frame.tileBins) bin.clear();
+    std::fill(frame.workerCounters.begin(), frame.workerCounters.end(), WorkerCounters{});
+
+    m_DrawDepthKeys.resize(drawCount);
+    m_SortedDepthKeys.resize(drawCount);
+    m_SortedDraws.resize(drawCount);
+    m_RadixOffsets.resize(static_cast<size_t>(m_ThreadPool.GetWorkerCount()) * RADIX_BUCKETS);
+}
+
+void Renderer::CullOccludedInstances(FrameContext& frame)
+{
+    const auto& meshes = m_pScene->GetMeshes();
+    const auto& instances = m_pScene->GetInstances();
+    std::vector<VisibleInstance>& visibleInstances = frame.visibleInstances;
+
+    // With static instances the depth of the last frame rasterized is reprojected as a starting point,
+    // the biggest instances on screen are drawn on top as occluders
+    frame.stats.isOcclusionReprojected = m_OcclusionBuffer.BeginFrame(frame.viewProjection, frame.isReversedZ,
+        m_HasOcclusionHistory && m_OcclusionHistoryVersion == frame.sceneVersion);
+
+    m_OccluderCandidates.clear();
+    for (uint32_t visibleIndex = 0; visibleIndex < visibleInstances.size(); ++visibleIndex) {
+        const VisibleInstance& visibleInstance = visibleInstances[visibleIndex];
+        const Mesh& mesh = meshes[instances[visibleInstance.instanceIndex].meshIndex];
+
+        const BoundingSphere sphere = mesh.boundingSphere.Transformed(visibleInstance.worldMatrix);
+        const float distance = std::max((sphere.center - m_Camera.origin).Magnitude() - sphere.radius, 0.1f);
+        const float screenRadius = sphere.radius * m_Height * 0.5f / (distance * m_Camera.fov);
+        if (screenRadius >= MIN_OCCLUDER_SCREEN_RADIUS) m_OccluderCandidates.push_back({ screenRadius, visibleIndex });
+    }
+
+    const size_t occluderCount = std::min(m_OccluderCandidates.size(), MAX_OCCLUDERS);
+    std::partial_sort(m_OccluderCandidates.begin(), m_OccluderCandidates.begin() + occluderCount, m_OccluderCandidates.end(),
+        [](const OccluderCandidate& a, const OccluderCandidate& b) { return a.screenRadius > b.screenRadius; });
+
+    // Occluders use the level of detail they are drawn with, so they drop exactly the triangles the full rasterizer drops,
+    // and shrink by one coarse pixel to make up for sampling at pixel centres
+    const float aspectRatio = static_cast<float>(m_Width) / m_Height;
+    const float shrinkPerDepth = 2.f * m_Camera.fov * std::max(1.f / OcclusionBuffer::HEIGHT, aspectRatio / OcclusionBuffer::WIDTH);
+
+    for (size_t occluder = 0; occluder < occluderCount; ++occluder) {
+        const VisibleInstance& visibleInstance = visibleInstances[m_OccluderCandidates[occluder].visibleInstance];
+        const Mesh& mesh = meshes[instances[visibleInstance.instanceIndex].meshIndex];
+
+        // Object space units, undo the instance scale
+        const float scale = mesh.boundingSphere.Transformed(visibleInstance.worldMatrix).radius / mesh.boundingSphere.radius;
+        m_OcclusionBuffer.RasterizeOccluder(mesh.vertices, mesh.lods[visibleInstance.lod].indices, visibleInstance.worldViewProjectionMatrix, shrinkPerDepth / scale);
+    }
+    frame.stats.occluders = static_cast<int>(occluderCount);
+
+    // Boxes are tested before any per-vertex work, an occluder can never hide itself
+    size_t keptCount = 0;
+    for (const VisibleInstance& visibleInstance : visibleInstances) {
+        const MeshInstance& instance = instances[visibleInstance.instanceIndex];
+        if (m_OcclusionBuffer.IsBoxOccluded(meshes[instance.meshIndex].boundingBox.Transformed(visibleInstance.worldMatrix))) continue;
+
+        visibleInstances[keptCount++] = visibleInstance;
+    }
+    frame.stats.instancesOccluded = static_cast<int>(visibleInstances.size() - keptCount);
+    visibleInstances.resize(keptCount);
+}
+
+uint32_t Renderer::SelectLod(const Mesh& mesh, const Matrix& worldMatrix) const
+{
+    if (!m_IsLodEnabled) return 0;
+
+    // Pixels per world unit at the instance's distance
+    const BoundingSphere sphere = mesh.boundingSphere.Transformed(worldMatrix);
+    const float distance = (sphere.center - m_Camera.origin).Magnitude() - sphere.radius;
+    if (distance <= 0.f) return 0;
+
+    const float pixelsPerUnit = m_Height * 0.5f / (distance * m_Camera.fov);
+    const float scale = sphere.radius / mesh.boundingSphere.radius;
+
+    // Coarsest level whose simplification error stays below the threshold on screen
+    uint32_t lod = 0;
+    while (lod + 1 < mesh.lods.size() && mesh.lods[lod + 1].error * scale * pixelsPerUnit <= m_LodPixelError) ++lod;
+    return lod;
+}
+
+bool Renderer::IsMeshletCulled(const Meshlet& meshlet, const Matrix& worldMatrix, const Frustum& frustum) const
+{
+    const BoundingSphere sphere = meshlet.boundingSphere.Transformed(worldMatrix);
+    if (!frustum.IsSphereVisible(sphere)) return true;
+
+    // Backface cone, every triangle is facing away when the eye sits inside the cone opposite the axis
+    if (meshlet.coneCutoff >= 1.f) return false;
+
+    const Vector3 axis = worldMatrix.TransformVector(meshlet.coneAxis).Normalized();
+    const Vector3 eyeToCenter = sphere.center - m_Camera.origin;
+    return Vector3::Dot(eyeToCenter, axis) >= meshlet.coneCutoff * eyeToCenter.Magnitude() + sphere.radius * (1.f + meshlet.coneCutoff);
+}
+
+void Renderer::TransformChunk(FrameContext& frame, int chunk, int worker)
+{
+    const auto& meshes = m_pScene->GetMeshes();
+    const auto& instances = m_pScene->GetInstances();
+    WorkerCounters& counters = frame.workerCounters[worker];
+    const Frustum frustum = Frustum::FromMatrix(frame.viewProjection);
+
+    // Culled meshlets are never transformed
+    const int lastDraw = std::min((chunk + 1) * DRAWS_PER_CHUNK, static_cast<int>(frame.meshletDraws.size()));
+    for (int drawIndex = chunk * DRAWS_PER_CHUNK; drawIndex < lastDraw; ++drawIndex) {
+        const MeshletDraw& draw = frame.meshletDraws[drawIndex];
+        const VisibleInstance& visibleInstance = frame.visibleInstances[draw.visibleInstance];
+        const Mesh& mesh = meshes[instances[visibleInstance.instanceIndex].meshIndex];
+        const MeshLod& lod = mesh.lods[visibleInstance.lod];
+        const Meshlet& meshlet = lod.meshlets[draw.meshlet];
+
+        frame.isDrawCulled[drawIndex] = IsMeshletCulled(meshlet, visibleInstance.worldMatrix, frustum);
+        if (frame.isDrawCulled[drawIndex]) {
+            ++counters.meshletsCulled;
+            continue;
+        }
+
+        VertexTransformationFunction(mesh, lod, meshlet, visibleInstance.worldMatrix, visibleInstance.worldViewProjectionMatrix,
+            &frame.transformedVertices[draw.vertexOffset]);
+        counters.lodTriangles[visibleInstance.lod] += static_cast<int>(meshlet.triangleCount);
+    }
+}
+
+void Renderer::BinChunk(FrameContext& frame, int chunk, int worker)
+{
+    const auto& meshes = m_pScene->GetMeshes();
+    const auto& instances = m_pScene->GetInstances();
+    WorkerCounters& counters = frame.workerCounters[worker];
+    std::vector<uint32_t>* pBins = &frame.tileBins[static_cast<size_t>(worker) * m_TileCountX * m_TileCountY];
+
+    const int lastDraw = std::min((chunk + 1) * DRAWS_PER_CHUNK, static_cast<int>(frame.meshletDraws.size()));
+    for (int drawIndex = chunk * DRAWS_PER_CHUNK; drawIndex < lastDraw; ++drawIndex) {
+        if (frame.isDrawCulled[drawIndex]) continue;
+
+        const MeshletDraw& draw = frame.meshletDraws[drawIndex];
+        const VisibleInstance& visibleInstance = frame.visibleInstances[draw.visibleInstance];
+        const MeshLod& lod = meshes[instances[visibleInstance.instanceIndex].meshIndex].lods[visibleInstance.lod];
+        const Meshlet& meshlet = lod.meshlets[draw.meshlet];
+        const Vertex_Out* pVertices = &frame.transformedVertices[draw.vertexOffset];
+        const uint8_t* pTriangles = &lod.meshletTriangles[meshlet.triangleOffset];
+
+        for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle) {
+            ScreenTriangle screenTriangle;
+            if (!SetupTriangle(pVertices[pTriangles[triangle * 3]], pVertices[pTriangles[triangle * 3 + 1]], pVertices[pTriangles[triangle * 3 + 2]],
+                frame.renderWidth, frame.renderHeight, screenTriangle)) continue;
+            ++counters.trianglesRasterized;
+            if (screenTriangle.minX >= screenTriangle.maxX || screenTriangle.minY >= screenTriangle.maxY) continue;
+
+            // Every tile the bounding box overlaps
+            const uint32_t id = static_cast<uint32_t>(drawIndex) << VISIBILITY_TRIANGLE_BITS | triangle;
+            for (int tileY = screenTriangle.minY / TILE_SIZE; tileY <= (screenTriangle.maxY - 1) / TILE_SIZE; ++tileY) {
+                for (int tileX = screenTriangle.minX / TILE_SIZE; tileX <= (screenTriangle.maxX - 1) / TILE_SIZE; ++tileX) {
+                    pBins[tileY * m_TileCountX + tileX].push_back(id);
                 }
             }
         }
     }
-    // Unlock after rendering
-    SDL_UnlockSurface(m_pBackBuffer);
+}
+
+void Renderer::RasterizeTile(FrameContext& frame, int tile, int worker)
+{
+    const auto& meshes = m_pScene->GetMeshes();
+    const auto& instances = m_pScene->GetInstances();
+    const auto& materials = m_pScene->GetMaterials();
+    WorkerCounters& counters = frame.workerCounters[worker];
+
+    const int tileX = tile % m_TileCountX * TILE_SIZE;
+    const int tileY = tile / m_TileCountX * TILE_SIZE;
+    // Tiles past the render extent show nothing this frame and keep whatever they hold
+    if (tileX >= frame.renderWidth || tileY >= frame.renderHeight) return;
+
+    // Clears cover the whole tile, frames rendered at a larger scale may have written past the current extent.
+    // Colors are only resolved inside it.
+    const int tileWidth = std::min(TILE_SIZE, m_Width - tileX);
+    const int tileHeight = std::min(TILE_SIZE, m_Height - tileY);
+    const int resolveWidth = std::min(tileWidth, frame.renderWidth - tileX);
+    const int resolveHeight = std::min(tileHeight, frame.renderHeight - tileY);
+    const bool isVisibilityBuffer = m_CurrentRenderPath == RenderPath::VisibilityBuffer;
+    const bool isMsaa = m_IsMsaa && m_CurrentRenderPath == RenderPath::Forward;
+    uint8_t& isDepthCleared = frame.isTileDepthCleared[tile];
+    uint8_t& isVisibilityCleared = m_IsTileVisibilityCleared[tile];
+
+    // Each tile clears its own pixels when the first triangle reaches it, and only the buffers not already clear.
+    // The visibility buffer only when this frame writes it.
+    bool isTileWritten{ false };
+    const auto initializeTile = [&] {
+        if (isMsaa) {
+            m_pSampleFramebuffer->Fill(tileX * MSAA_SAMPLES, tileY, tileWidth * MSAA_SAMPLES, tileHeight, CLEAR_COLOR);
+            m_SampleDepthBuffer.Clear(tileX * MSAA_SAMPLES, tileY, tileWidth * MSAA_SAMPLES, tileHeight, false);
+        }
+        else {
+            m_pFramebuffer->Fill(tileX, tileY, tileWidth, tileHeight, CLEAR_COLOR);
+        }
+        if (!isDepthCleared) m_pDepthBuffer->Clear(tileX, tileY, tileWidth, tileHeight, false);
+        if (isVisibilityBuffer && !isVisibilityCleared) {
+            for (int py = tileY; py < tileY + tileHeight; ++py) {
+                std::fill_n(&m_VisibilityBuffer[tileX + py * m_Width], tileWidth, EMPTY_VISIBILITY);
+            }
+        }
+        isDepthCleared = false;
+        if (isVisibilityBuffer) isVisibilityCleared = false;
+        isTileWritten = true;
+    };
+
+    // Ids grow with the draw order, sorting the merged bins restores it so the depth test keeps the same one of two equal depths
+    std::vector<uint32_t>& triangles = m_TileTriangles[worker];
+    triangles.clear();
+    const size_t tileCount = static_cast<size_t>(m_TileCountX) * m_TileCountY;
+    for (size_t binWorker = 0; binWorker < m_TileTriangles.size(); ++binWorker) {
+        const std::vector<uint32_t>& bin = frame.tileBins[binWorker * tileCount + tile];
+        triangles.insert(triangles.end(), bin.begin(), bin.end());
+    }
+    if (!std::is_sorted(triangles.begin(), triangles.end())) std::sort(triangles.begin(), triangles.end());
+
+    const auto forEachTriangle = [&](const auto& rasterize) {
+        for (const uint32_t id : triangles) {
+            const MeshletDraw& draw = frame.meshletDraws[id >> VISIBILITY_TRIANGLE_BITS];
+            const VisibleInstance& visibleInstance = frame.visibleInstances[draw.visibleInstance];
+            const MeshInstance& instance = instances[visibleInstance.instanceIndex];
+            const MeshLod& lod = meshes[instance.meshIndex].lods[visibleInstance.lod];
+            const uint8_t* pTriangle = &lod.meshletTriangles[lod.meshlets[draw.meshlet].triangleOffset + (id & VISIBILITY_TRIANGLE_MASK) * 3];
+            const Vertex_Out& vertex0 = frame.transformedVertices[draw.vertexOffset + pTriangle[0]];
+            const Vertex_Out& vertex1 = frame.transformedVertices[draw.vertexOffset + pTriangle[1]];
+            const Vertex_Out& vertex2 = frame.transformedVertices[draw.vertexOffset + pTriangle[2]];
+
+            ScreenTriangle screenTriangle;
+            if (!SetupTriangle(vertex0, vertex1, vertex2, frame.renderWidth, frame.renderHeight, screenTriangle) || !ClampToTile(screenTriangle, tile)) continue;
+            if (!isTileWritten) initializeTile();
+            rasterize(id, vertex0, vertex1, vertex2, screenTriangle, materials[instance.materialIndex]);
+        }
+    };
 
-    // Copy the back buffer to the front buffer for display
-    SDL_BlitSurface(m_pBackBuffer, nullptr, m_pFrontBuffer, nullptr);
-    SDL_UpdateWindowSurface(m_pWindow);
+    // The pixel loops are compiled once per depth format
+    const int shadingRate = SelectShadingRate(tile);
+    m_pDepthBuffer->VisitFormat([&](auto depthFormat) {
+        using Format = decltype(depthFormat);
+        const auto shadeTriangles = [&](auto isMsaaConstant) {
+            forEachTriangle([&](uint32_t, const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, const ScreenTriangle& screenTriangle,
+                const Material& material) {
+                    ShadeTriangle<Format, decltype(isMsaaConstant)::value>(vertex0, vertex1, vertex2, screenTriangle, material, shadingRate,
+                        counters.pixelsShaded, counters.pixelsBroadcast, counters.fragmentsRejected);
+                });
+        };
+        const auto rasterizeDepth = [&](bool isWritingVisibility, int& fragmentsRejected) {
+            forEachTriangle([&](uint32_t id, const Vertex_Out&, const Vertex_Out&, const Vertex_Out&, const ScreenTriangle& screenTriangle, const Material&) {
+                RasterizeDepth<Format>(screenTriangle, isWritingVisibility ? id : EMPTY_VISIBILITY, fragmentsRejected);
+                });
+        };
+
+        switch (m_CurrentRenderPath)
+        {
+        case RenderPath::Forward:
+            if (isMsaa) shadeTriangles(std::true_type{});
+            else shadeTriangles(std::false_type{});
+            break;
+        case RenderPath::DepthPrepass:
+        {
+            // Depth first, then every pixel is shaded once by the fragment that matches it.
+            // The color pass reports the same geometry, the depth pass counts nothing.
+            int depthFragmentsRejected{ 0 };
+            rasterizeDepth(false, depthFragmentsRejected);
+            shadeTriangles(std::false_type{});
+            break;
+        }
+        case RenderPath::VisibilityBuffer:
+            rasterizeDepth(true, counters.fragmentsRejected);
+            break;
+        }
+        });
+
+    if (!isTileWritten) {
+        // Depth left from an earlier frame would end up in the occlusion history, stale ids in the resolve pass
+        if (!isDepthCleared) {
+            m_pDepthBuffer->Clear(tileX, tileY, tileWidth, tileHeight, true);
+            isDepthCleared = true;
+        }
+        if (isVisibilityBuffer && !isVisibilityCleared) {
+            StreamFill(m_VisibilityBuffer.data(), m_Width, tileX, tileY, tileWidth, tileHeight, EMPTY_VISIBILITY);
+            isVisibilityCleared = true;
+        }
+    }
+
+    // Colors are final unless the resolve pass still has to shade them, untouched tiles are packed without reading the floats
+    if (isVisibilityBuffer) return;
+    if (isTileWritten && isMsaa) {
+        m_pFramebuffer->ResolveSamples(*m_pSampleFramebuffer, MSAA_SAMPLES, tileX, tileY, tileWidth, tileHeight);
+        m_pDepthBuffer->ResolveSamples(m_SampleDepthBuffer, MSAA_SAMPLES, tileX, tileY, tileWidth, tileHeight);
+    }
+    if (isTileWritten) {
+        m_pFramebuffer->Resolve(tileX, tileY, resolveWidth, resolveHeight, GetResolvePixels(frame));
+        ++counters.tilesPerShadingRate[shadingRate >> 1];
+    }
+    else {
+        StreamFill(GetResolvePixels(frame), m_Width, tileX, tileY, resolveWidth, resolveHeight, Framebuffer::Pack(CLEAR_COLOR));
+    }
+    if (m_ShadingRate == ShadingRate::Adaptive) {
+        m_TileContrast[tile] = isTileWritten ? m_pFramebuffer->GetContrast(tileX, tileY, resolveWidth, resolveHeight) : 0.f;
+    }
 }
 
+int Renderer::SelectShadingRate(int tile) const
+{
+    switch (m_ShadingRate)
+    {
+    case ShadingRate::Coarse2x2:
+        return 2;
+    case ShadingRate::Coarse4x4:
+        return 4;
+    case ShadingRate::Adaptive:
+        // Flat tiles lose little to coarse shading, the estimate lags a frame behind the motion
+        if (m_TileContrast[tile] < COARSE_4X4_CONTRAST) return 4;
+        if (m_TileContrast[tile] < COARSE_2X2_CONTRAST) return 2;
+        return 1;
+    default:
+        return 1;
+    }
+}
 
+bool Renderer::ClampToTile(ScreenTriangle& triangle, int tile) const
+{
+    const int tileX = tile % m_TileCountX * TILE_SIZE;
+    const int tileY = tile / m_TileCountX * TILE_SIZE;
+
+    triangle.minX = std::max(triangle.minX, tileX);
+    triangle.maxX = std::min(triangle.maxX, tileX + TILE_SIZE);
+    triangle.minY = std::max(triangle.minY, tileY);
+    triangle.maxY = std::min(triangle.maxY, tileY + TILE_SIZE);
+    return triangle.minX < triangle.maxX && triangle.minY < triangle.maxY;
+}
 
-void Renderer::VertexTransformationFunction(Mesh& mesh) const
+void Renderer::ComputeSortKeys(FrameContext& frame, int chunk)
 {
+    const auto& meshes = m_pScene->GetMeshes();
+    const auto& instances = m_pScene->GetInstances();
+
+    // Nearest view depth of each meshlet's bounding sphere, quantized over the depth range
+    const float depthScale = 65535.f / m_Camera.farPlane;
+    const int lastDraw = std::min((chunk + 1) * DRAWS_PER_CHUNK, static_cast<int>(frame.meshletDraws.size()));
+    for (int drawIndex = chunk * DRAWS_PER_CHUNK; drawIndex < lastDraw; ++drawIndex) {
+        const MeshletDraw& draw = frame.meshletDraws[drawIndex];
+        const VisibleInstance& visibleInstance = frame.visibleInstances[draw.visibleInstance];
+        const Meshlet& meshlet = meshes[instances[visibleInstance.instanceIndex].meshIndex].lods[visibleInstance.lod].meshlets[draw.meshlet];
+
+        const BoundingSphere sphere = meshlet.boundingSphere.Transformed(visibleInstance.worldMatrix);
+        const float depth = Vector3::Dot(sphere.center - m_Camera.origin, m_Camera.forward) - sphere.radius;
+        m_DrawDepthKeys[drawIndex] = static_cast<uint16_t>(std::clamp(depth * depthScale, 0.f, 65535.f));
+    }
+}
 
-    // Precompute transformation matrix
-  
-    auto rotatedWorldMatrix = m_MatrixRot * mesh.worldMatrix;
-    auto overallMatrix = rotatedWorldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
+// Parallel LSD radix sort, each part histograms and scatters its own contiguous range so the sort stays stable
+int Renderer::RadixPartFirst(int part) const
+{
+    return static_cast<int>(static_cast<int64_t>(m_DrawDepthKeys.size()) * part / m_ThreadPool.GetWorkerCount());
+}
 
-    // Resize vertices_out to match input vertices
-    mesh.vertices_out.resize(mesh.vertices.size());
-    
-    // Transform vertices in parallel
-#pragma omp parallel for
-    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
-        mesh.vertices_out[i].normal = rotatedWorldMatrix.TransformVector(mesh.vertices[i].normal).Normalized();
+void Renderer::RadixHistogram(int part, int pass)
+{
+    const std::vector<uint16_t>& keys = pass % 2 == 0 ? m_DrawDepthKeys : m_SortedDepthKeys;
+    const int shift = pass * RADIX_BITS;
 
-        mesh.vertices_out[i].tangent = rotatedWorldMatrix.TransformVector(mesh.vertices[i].tangent).Normalized();
-       
-      
-        auto rotatedWorldPosition = rotatedWorldMatrix.TransformPoint(mesh.vertices[i].position);
-        mesh.vertices_out[i].viewDirection = rotatedWorldPosition - m_Camera.origin;
-        mesh.vertices_out[i].viewDirection.Normalize();
+    uint32_t* pOffsets = &m_RadixOffsets[static_cast<size_t>(part) * RADIX_BUCKETS];
+    std::fill(pOffsets, pOffsets + RADIX_BUCKETS, 0u);
+    for (int index = RadixPartFirst(part); index < RadixPartFirst(part + 1); ++index) {
+        ++pOffsets[(keys[index] >> shift) & (RADIX_BUCKETS - 1)];
+    }
+}
 
-        Vector4 viewSpacePosition = overallMatrix.TransformPoint(mesh.vertices[i].position.ToVector4());
+void Renderer::RadixPrefixSum()
+{
+    // Exclusive prefix sum in bucket-major, part-minor order
+    const int partCount = m_ThreadPool.GetWorkerCount();
+    uint32_t offset = 0;
+    for (int bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+        for (int part = 0; part < partCount; ++part) {
+            const uint32_t count = m_RadixOffsets[static_cast<size_t>(part) * RADIX_BUCKETS + bucket];
+            m_RadixOffsets[static_cast<size_t>(part) * RADIX_BUCKETS + bucket] = offset;
+            offset += count;
+        }
+    }
+}
 
-        
+void Renderer::RadixScatter(FrameContext& frame, int part, int pass)
+{
+    const bool isEvenPass = pass % 2 == 0;
+    const std::vector<uint16_t>& keys = isEvenPass ? m_DrawDepthKeys : m_SortedDepthKeys;
+    const std::vector<MeshletDraw>& draws = isEvenPass ? frame.meshletDraws : m_SortedDraws;
+    std::vector<uint16_t>& sortedKeys = isEvenPass ? m_SortedDepthKeys : m_DrawDepthKeys;
+    std::vector<MeshletDraw>& sortedDraws = isEvenPass ? m_SortedDraws : frame.meshletDraws;
+    const int shift = pass * RADIX_BITS;
+
+    uint32_t* pOffsets = &m_RadixOffsets[static_cast<size_t>(part) * RADIX_BUCKETS];
+    for (int index = RadixPartFirst(part); index < RadixPartFirst(part + 1); ++index) {
+        const uint32_t destination = pOffsets[(keys[index] >> shift) & (RADIX_BUCKETS - 1)]++;
+        sortedKeys[destination] = keys[index];
+        sortedDraws[destination] = draws[index];
+    }
+}
 
-        Vector4 projectionSpacePosition = viewSpacePosition / viewSpacePosition.w;
-       
+void Renderer::ResolveTile(FrameContext& frame, int tile, int worker)
+{
+    const auto& meshes = m_pScene->GetMeshes();
+    const auto& instances = m_pScene->GetInstances();
+
+    const int tileX = tile % m_TileCountX * TILE_SIZE;
+    const int tileY = tile / m_TileCountX * TILE_SIZE;
+    if (tileX >= frame.renderWidth || tileY >= frame.renderHeight) return;
+    const int lastX = std::min(tileX + TILE_SIZE, frame.renderWidth);
+    const int lastY = std::min(tileY + TILE_SIZE, frame.renderHeight);
+    WorkerCounters& counters = frame.workerCounters[worker];
+
+    // The reprojection cache keeps the triangle and color age of every pixel for the next frame, which looks them up in the presented image,
+    // so only frames presented as resolved take part
+    const bool isWritingHistory = m_IsReprojectionCache && !IsUpscaled(frame);
+    const bool isReprojecting = isWritingHistory && m_pHistoryFrame;
+    const auto writeHistory = [&](int pixelIndex, uint64_t triangleKey, uint8_t colorAge) {
+        if (!isWritingHistory) return;
+        frame.triangleKeys[pixelIndex] = triangleKey;
+        frame.colorAges[pixelIndex] = colorAge;
+    };
 
-        projectionSpacePosition.x = projectionSpacePosition.x * 0.5f + 0.5f;
-        projectionSpacePosition.y = (1.0f - projectionSpacePosition.y) * 0.5f;
+    // Nothing reached the tile, the float colors were never filled
+    if (m_IsTileVisibilityCleared[tile]) {
+        StreamFill(GetResolvePixels(frame), m_Width, tileX, tileY, lastX - tileX, lastY - tileY, Framebuffer::Pack(CLEAR_COLOR));
+        if (isWritingHistory) {
+            for (int py = tileY; py < lastY; ++py) {
+                std::fill_n(&frame.triangleKeys[tileX + static_cast<size_t>(py) * m_Width], lastX - tileX, EMPTY_TRIANGLE_KEY);
+            }
+        }
+        if (m_ShadingRate == ShadingRate::Adaptive) m_TileContrast[tile] = 0.f;
+        return;
+    }
 
-        mesh.vertices_out[i].position = projectionSpacePosition;
-        mesh.vertices_out[i].color = mesh.vertices[i].color;
-        mesh.vertices_out[i].uv = mesh.vertices[i].uv;
+    // Triangles shaded so far in each coarse block of the current row of blocks and the pixel each was shaded at,
+    // triangles past the first few of a block are shaded per pixel
+    const int shadingRate = SelectShadingRate(tile);
+    struct BlockSample
+    {
+        uint32_t id;
+        int pixelIndex;
+    };
+    constexpr int MAX_BLOCK_SAMPLES{ 4 };
+    std::array<std::array<BlockSample, MAX_BLOCK_SAMPLES>, TILE_SIZE / 2> blockSamples;
+    std::array<int, TILE_SIZE / 2> blockSampleCounts{};
+
+    for (int py = tileY; py < lastY; ++py) {
+        if (shadingRate > 1 && (py - tileY) % shadingRate == 0) blockSampleCounts.fill(0);
+
+        // Neighbouring pixels mostly hit the same triangle, its setup is reused along the row
+        uint32_t setupId{ EMPTY_VISIBILITY };
+        ScreenTriangle screenTriangle{};
+        const Vertex_Out* pTriangleVertices[3]{};
+        const Material* pMaterial{};
+        uint64_t triangleKey{ EMPTY_TRIANGLE_KEY };
+        Matrix reprojection{};
+
+        for (int px = tileX; px < lastX; ++px) {
+            const int pixelIndex = px + (py * m_Width);
+            const uint32_t id = m_VisibilityBuffer[pixelIndex];
+            if (id == EMPTY_VISIBILITY) {
+                writeHistory(pixelIndex, EMPTY_TRIANGLE_KEY, 0);
+                continue;
+            }
+
+            if (id != setupId) {
+                const MeshletDraw& draw = frame.meshletDraws[id >> VISIBILITY_TRIANGLE_BITS];
+                const VisibleInstance& visibleInstance = frame.visibleInstances[draw.visibleInstance];
+                const MeshInstance& instance = instances[visibleInstance.instanceIndex];
+                const MeshLod& lod = meshes[instance.meshIndex].lods[visibleInstance.lod];
+                const uint8_t* pTriangle = &lod.meshletTriangles[lod.meshlets[draw.meshlet].triangleOffset + (id & VISIBILITY_TRIANGLE_MASK) * 3];
+
+                for (int corner = 0; corner < 3; ++corner) {
+                    pTriangleVertices[corner] = &frame.transformedVertices[draw.vertexOffset + pTriangle[corner]];
+                }
+                SetupTriangle(*pTriangleVertices[0], *pTriangleVertices[1], *pTriangleVertices[2], frame.renderWidth, frame.renderHeight, screenTriangle);
+                pMaterial = &m_pScene->GetMaterials()[instance.materialIndex];
+                setupId = id;
+
+                triangleKey = MakeTriangleKey(visibleInstance.instanceIndex, visibleInstance.lod, draw.meshlet, id & VISIBILITY_TRIANGLE_MASK);
+                // Back from this frame's view space into the instance, then into last frame's view space with the instance's rotation at the time.
+                // Without the projections the matrices stay affine, inverting them keeps far depth precise.
+                if (isReprojecting) {
+                    reprojection = Matrix::Inverse(visibleInstance.worldMatrix * frame.view) * (m_HistoryRotation * instance.worldMatrix * m_HistoryView);
+                }
+            }
+
+            float interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue;
+            bool isComputed{ false };
+            // Pixels shaded for lack of history start partway through their reuses, so the refreshes after a cut spread over the next frames
+            uint8_t colorAge = static_cast<uint8_t>((px + py * 2) % (MAX_REUSE_AGE + 1));
+            if (isReprojecting) {
+                if (!ComputePixel(screenTriangle, px, py, interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue)) {
+                    writeHistory(pixelIndex, EMPTY_TRIANGLE_KEY, 0);
+                    continue;
+                }
+                isComputed = true;
+
+                // Perspective correct view depth, as ShadePixel interpolates it
+                const float viewDepth = screenTriangle.wProduct / (screenTriangle.v1.w * screenTriangle.v2.w * interpolationScale0
+                    + screenTriangle.v0.w * screenTriangle.v2.w * interpolationScale1 + screenTriangle.v0.w * screenTriangle.v1.w * interpolationScale2);
+
+                ++counters.pixelsReprojected;
+                ColorRGB reusedColor;
+                if (LookUpHistory(frame, reprojection, triangleKey, px, py, viewDepth, reusedColor, colorAge)) {
+                    m_pFramebuffer->SetColor(pixelIndex, reusedColor);
+                    writeHistory(pixelIndex, triangleKey, colorAge);
+                    ++counters.pixelsReused;
+                    continue;
+                }
+            }
+
+            const int block = (px - tileX) / shadingRate;
+            if (shadingRate > 1) {
+                const auto firstSample = blockSamples[block].begin();
+                const auto lastSample = firstSample + blockSampleCounts[block];
+                const auto sample = std::find_if(firstSample, lastSample, [id](const BlockSample& blockSample) { return blockSample.id == id; });
+                if (sample != lastSample) {
+                    m_pFramebuffer->SetColor(pixelIndex, m_pFramebuffer->GetColor(sample->pixelIndex));
+                    writeHistory(pixelIndex, triangleKey, colorAge);
+                    ++counters.pixelsBroadcast;
+                    continue;
+                }
+            }
+
+            if ((!isComputed && !ComputePixel(screenTriangle, px, py, interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue))
+                || !ShadePixel(*pTriangleVertices[0], *pTriangleVertices[1], *pTriangleVertices[2], screenTriangle, px, py,
+                    interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue, *pMaterial)) {
+                writeHistory(pixelIndex, EMPTY_TRIANGLE_KEY, 0);
+                continue;
+            }
+            writeHistory(pixelIndex, triangleKey, colorAge);
+            ++counters.pixelsShaded;
+            if (shadingRate > 1 && blockSampleCounts[block] < MAX_BLOCK_SAMPLES) {
+                blockSamples[block][blockSampleCounts[block]++] = { id, pixelIndex };
+            }
+        }
+    }
+
+    m_pFramebuffer->Resolve(tileX, tileY, lastX - tileX, lastY - tileY, GetResolvePixels(frame));
+    ++counters.tilesPerShadingRate[shadingRate >> 1];
+    if (m_ShadingRate == ShadingRate::Adaptive) {
+        m_TileContrast[tile] = m_pFramebuffer->GetContrast(tileX, tileY, lastX - tileX, lastY - tileY);
+    }
+}
+
+bool Renderer::LookUpHistory(const FrameContext& frame, const Matrix& reprojection, uint64_t triangleKey, int px, int py, float viewDepth,
+    ColorRGB& color, uint8_t& colorAge) const
+{
+    // The pixel center in view space, then where last frame's camera saw that point
+    const float ndcX = (px + .5f) / m_Width * 2.f - 1.f;
+    const float ndcY = 1.f - (py + .5f) / m_Height * 2.f;
+    const Vector3 previous = reprojection.TransformPoint(ndcX * viewDepth / frame.projection[0][0], ndcY * viewDepth / frame.projection[1][1], viewDepth);
+    if (previous.z <= 0.f) return false;
+    const float previousX = (previous.x * m_HistoryProjection[0][0] / previous.z * .5f + .5f) * m_Width;
+    const float previousY = (1.f - previous.y * m_HistoryProjection[1][1] / previous.z) * .5f * m_Height;
+    if (!(previousX >= 0.f && previousX < m_Width && previousY >= 0.f && previousY < m_Height)) return false;
+
+    const int previousIndex = static_cast<int>(previousX) + static_cast<int>(previousY) * m_Width;
+    if (m_pHistoryFrame->triangleKeys[previousIndex] != triangleKey) return false;
+
+    // The key only says the triangle was seen in that pixel, the depth says it was this spot of it.
+    // Compared as view depth, buffer depth barely changes with distance far away.
+    const float storedDepth = m_pHistoryFrame->depthBuffer.GetDepth(static_cast<int>(previousX), static_cast<int>(previousY));
+    const float storedViewDepth = m_HistoryProjection[3][2] / (storedDepth - m_HistoryProjection[2][2]);
+    if (!(std::abs(storedViewDepth - previous.z) <= REUSE_DEPTH_TOLERANCE * previous.z)) return false;
+
+    const uint8_t previousAge = m_pHistoryFrame->colorAges[previousIndex];
+    if (previousAge >= MAX_REUSE_AGE) {
+        colorAge = 0;
+        return false;
     }
+    colorAge = static_cast<uint8_t>(previousAge + 1);
+
+    // Half a step above each channel, so the resolve packs the same value again
+    const uint32_t packed = m_pHistoryPixels[previousIndex];
+    color = ColorRGB{ ((packed >> 16 & 0xFF) + .5f) / 255.f, ((packed >> 8 & 0xFF) + .5f) / 255.f, ((packed & 0xFF) + .5f) / 255.f };
+    return true;
 }
 
-void Renderer::PixelShading(Vertex_Out& v)
+void Renderer::UpscaleBand(FrameContext& frame, int band, int worker)
+{
+    if (!IsUpscaled(frame)) return;
+
+    const int firstRow = band * UPSCALE_ROWS;
+    const int lastRow = std::min(firstRow + UPSCALE_ROWS, m_Height);
+    Framebuffer::Upscale(m_ScaledPixels.data(), frame.renderWidth, frame.renderHeight, m_pBackBufferPixels, m_Width, m_Height, m_Width,
+        firstRow, lastRow, m_UpscaleRows[worker].data());
+}
+
+bool Renderer::IsUpscaled(const FrameContext& frame) const
+{
+    return frame.renderWidth != m_Width || frame.renderHeight != m_Height;
+}
+
+uint32_t* Renderer::GetResolvePixels(const FrameContext& frame)
+{
+    return IsUpscaled(frame) ? m_ScaledPixels.data() : m_pBackBufferPixels;
+}
+
+Vector4 Renderer::ProjectVertex(const Vector3& position, const Matrix& overallMatrix)
+{
+    Vector4 viewSpacePosition = overallMatrix.TransformPoint(position.ToVector4());
+    Vector4 projectionSpacePosition = viewSpacePosition / viewSpacePosition.w;
+
+    projectionSpacePosition.x = projectionSpacePosition.x * 0.5f + 0.5f;
+    projectionSpacePosition.y = (1.0f - projectionSpacePosition.y) * 0.5f;
+
+    return projectionSpacePosition;
+}
+
+void Renderer::VertexTransformationFunction(const Mesh& mesh, const MeshLod& lod, const Meshlet& meshlet, const Matrix& rotatedWorldMatrix, const Matrix& overallMatrix,
+    Vertex_Out* pVerticesOut) const
+{
+    // Transform the meshlet's vertices, indexed by their meshlet-local index
+    for (uint32_t local = 0; local < meshlet.vertexCount; ++local) {
+        const Vertex& vertex = mesh.vertices[lod.meshletVertices[meshlet.vertexOffset + local]];
+        Vertex_Out& vertexOut = pVerticesOut[local];
+
+        vertexOut.normal = rotatedWorldMatrix.TransformVector(vertex.normal).Normalized();
+        vertexOut.tangent = rotatedWorldMatrix.TransformVector(vertex.tangent).Normalized();
+
+        auto rotatedWorldPosition = rotatedWorldMatrix.TransformPoint(vertex.position);
+        vertexOut.viewDirection = rotatedWorldPosition - m_Camera.origin;
+        vertexOut.viewDirection.Normalize();
+
+        vertexOut.position = ProjectVertex(vertex.position, overallMatrix);
+        vertexOut.color = vertex.color;
+        vertexOut.uv = vertex.uv;
+    }
+}
+
+bool Renderer::SetupTriangle(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, int width, int height, ScreenTriangle& triangle) const
+{
+    // Vertex positions
+    auto v0 = vertex0.position;
+    auto v1 = vertex1.position;
+    auto v2 = vertex2.position;
+
+    // Skip if any vertex is behind the camera (w < 0)
+    if (v0.w < 0 || v1.w < 0 || v2.w < 0) return false;
+
+    if ((v0.x < -1  || v0.x > 1) || (v1.x < -1 || v1.x > 1) || (v2.x < -1 || v2.x > 1)
+        || ((v0.y < -1 || v0.y > 1) || (v1.y < -1 || v1.y > 1) || (v2.y < -1 || v2.y > 1))
+        || ((v0.z < 0 || v0.z > 1) || (v1.z < 0 || v1.z > 1) || (v2.z < 0 || v2.z > 1))) return false;
+
+
+    // Backface culling (skip if the triangle is facing away from the camera)
+    Vector3 edge0 = v1 - v0;
+    Vector3 edge1 = v2 - v0;
+    Vector3 normal = Vector3::Cross(edge0, edge1);
+    if (normal.z <= 0) return false;
+
+
+    // Transform coordinates to screen space
+    v0.x *= width;
+    v1.x *= width;
+    v2.x *= width;
+    v0.y *= height;
+    v1.y *= height;
+    v2.y *= height;
+
+    // Compute bounding box of the triangle
+    triangle.minX = std::max(0, static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))));
+    triangle.maxX = std::min(width, static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))));
+    triangle.minY = std::max(0, static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))));
+    triangle.maxY = std::min(height, static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))));
+
+    // Edge vectors for barycentric coordinates
+    auto e0 = v2 - v1;
+    auto e1 = v0 - v2;
+    auto e2 = v1 - v0;
+
+    triangle.edge0 = Vector2(e0.x, e0.y);
+    triangle.edge1 = Vector2(e1.x, e1.y);
+    triangle.edge2 = Vector2(e2.x, e2.y);
+
+    triangle.v0 = v0;
+    triangle.v1 = v1;
+    triangle.v2 = v2;
+    triangle.wProduct = v0.w * v1.w * v2.w;
+
+    return true;
+}
+
+bool Renderer::ComputePixel(const ScreenTriangle& triangle, int px, int py,
+    float& interpolationScale0, float& interpolationScale1, float& interpolationScale2, float& zBufferValue) const
+{
+    return ComputePoint(triangle, px + 0.5f, py + 0.5f, interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue);
+}
+
+bool Renderer::ComputePoint(const ScreenTriangle& triangle, float x, float y,
+    float& interpolationScale0, float& interpolationScale1, float& interpolationScale2, float& zBufferValue) const
+{
+    auto P = Vector2(x, y);
+
+    auto p0 = P - Vector2(triangle.v1.x, triangle.v1.y);
+    auto p1 = P - Vector2(triangle.v2.x, triangle.v2.y);
+    auto p2 = P - Vector2(triangle.v0.x, triangle.v0.y);
+
+    auto weightP0 = Vector2::Cross(triangle.edge0, p0);
+    auto weightP1 = Vector2::Cross(triangle.edge1, p1);
+    auto weightP2 = Vector2::Cross(triangle.edge2, p2);
+
+    if (weightP0 < 0 || weightP1 < 0 || weightP2 < 0) return false;
+
+    auto totalArea = weightP0 + weightP1 + weightP2;
+    float reciprocalTotalArea = 1.0f / totalArea;
+
+    interpolationScale0 = weightP0 * reciprocalTotalArea;
+    interpolationScale1 = weightP1 * reciprocalTotalArea;
+    interpolationScale2 = weightP2 * reciprocalTotalArea;
+
+    // Compute z-buffer value for depth testing
+    zBufferValue = 1.f / (1.f / triangle.v0.z * interpolationScale0 +
+        1.f / triangle.v1.z * interpolationScale1 +
+        1.f / triangle.v2.z * interpolationScale2);
+
+    return zBufferValue >= 0 && zBufferValue <= 1;
+}
+
+int Renderer::ComputeSampleCoverage(const ScreenTriangle& triangle, int px, int py, float* pSampleDepths) const
+{
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+    // The operations of ComputePoint in the same order, one sample per lane, so both agree bit for bit
+    const __m128 x = _mm_add_ps(_mm_set1_ps(static_cast<float>(px)), _mm_loadu_ps(MSAA_SAMPLE_X.data()));
+    const __m128 y = _mm_add_ps(_mm_set1_ps(static_cast<float>(py)), _mm_loadu_ps(MSAA_SAMPLE_Y.data()));
+    const auto edgeFunction = [&](const Vector2& edge, const Vector4& origin) {
+        return _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(edge.x), _mm_sub_ps(y, _mm_set1_ps(origin.y))),
+            _mm_mul_ps(_mm_set1_ps(edge.y), _mm_sub_ps(x, _mm_set1_ps(origin.x))));
+    };
+    const __m128 weight0 = edgeFunction(triangle.edge0, triangle.v1);
+    const __m128 weight1 = edgeFunction(triangle.edge1, triangle.v2);
+    const __m128 weight2 = edgeFunction(triangle.edge2, triangle.v0);
+
+    // Not less than zero rather than greater or equal, NaN counts as covered like in the scalar test
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 isCovered = _mm_and_ps(_mm_and_ps(_mm_cmpnlt_ps(weight0, zero), _mm_cmpnlt_ps(weight1, zero)), _mm_cmpnlt_ps(weight2, zero));
+
+    const __m128 reciprocalTotalArea = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(weight0, weight1), weight2));
+    const __m128 depth = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(_mm_set1_ps(1.f / triangle.v0.z), _mm_mul_ps(weight0, reciprocalTotalArea)),
+        _mm_mul_ps(_mm_set1_ps(1.f / triangle.v1.z), _mm_mul_ps(weight1, reciprocalTotalArea))),
+        _mm_mul_ps(_mm_set1_ps(1.f / triangle.v2.z), _mm_mul_ps(weight2, reciprocalTotalArea))));
+    const __m128 isInRange = _mm_and_ps(_mm_cmpge_ps(depth, zero), _mm_cmple_ps(depth, one));
+
+    _mm_storeu_ps(pSampleDepths, depth);
+    return _mm_movemask_ps(_mm_and_ps(isCovered, isInRange));
+#else
+    int coverage{ 0 };
+    for (int sample = 0; sample < MSAA_SAMPLES; ++sample) {
+        float interpolationScale0, interpolationScale1, interpolationScale2;
+        if (ComputePoint(triangle, px + MSAA_SAMPLE_X[sample], py + MSAA_SAMPLE_Y[sample],
+            interpolationScale0, interpolationScale1, interpolationScale2, pSampleDepths[sample])) coverage |= 1 << sample;
+    }
+    return coverage;
+#endif
+}
+
+bool Renderer::ShadePixel(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, const ScreenTriangle& triangle, int px, int py,
+    float interpolationScale0, float interpolationScale1, float interpolationScale2, float zBufferValue, const Material& material)
+{
+    const Vector4& v0 = triangle.v0;
+    const Vector4& v1 = triangle.v1;
+    const Vector4& v2 = triangle.v2;
+    const float wProduct = triangle.wProduct;
+
+    // Interpolated depth for final color calculation
+    float interpolatedDepth = wProduct / (v1.w * v2.w * interpolationScale0 +
+        v0.w * v2.w * interpolationScale1 +
+        v0.w * v1.w * interpolationScale2);
+    if (interpolatedDepth <= 0) return false;
+
+    ColorRGB finalColor;
+
+    // Texture sampling
+    Vertex_Out pixelVertex;
+
+    pixelVertex.position = Vector4{ px + 0.5f, py + 0.5f, 0.f, 0.f };
+    pixelVertex.position.z = zBufferValue;
+    pixelVertex.position.w = interpolatedDepth;
+
+
+    pixelVertex.uv = Vector2::Interpolate(vertex0.uv, vertex1.uv, vertex2.uv,
+        v0.w, v1.w, v2.w, interpolationScale0, interpolationScale1, interpolationScale2, interpolatedDepth, wProduct);
+
+    pixelVertex.normal = Vector3::Interpolate(vertex0.normal, vertex1.normal, vertex2.normal,
+        v0.w, v1.w, v2.w, interpolationScale0, interpolationScale1, interpolationScale2, interpolatedDepth, wProduct);
+    pixelVertex.normal.Normalize();
+
+
+    pixelVertex.tangent = Vector3::Interpolate(vertex0.tangent, vertex1.tangent, vertex2.tangent,
+        v0.w, v1.w, v2.w, interpolationScale0, interpolationScale1, interpolationScale2, interpolatedDepth, wProduct);
+    pixelVertex.tangent.Normalize();
+
+    pixelVertex.viewDirection = Vector3::Interpolate(vertex0.viewDirection, vertex1.viewDirection, vertex2.viewDirection,
+        v0.w, v1.w, v2.w, interpolationScale0, interpolationScale1, interpolationScale2, interpolatedDepth, wProduct);
+    pixelVertex.viewDirection.Normalize();
+
+    pixelVertex.color = colors::Black;
+
+    // If texture mapping is enabled, sample the texture
+    if (m_CurrentDisplayMode == DisplayMode::FinalColor)
+    {
+        finalColor = material.pDiffuse ? material.pDiffuse->Sample(pixelVertex.uv) : colors::White;
+    }
+    if (m_CurrentDisplayMode == DisplayMode::DepthBuffer)
+    {
+        // Shown as standard depth either way, reversed depth mirrors it
+        const float standardDepth = m_Camera.isReversedZ ? 1.f - zBufferValue : zBufferValue;
+        auto clampedValue = Remap(standardDepth, 0.8f, 1.f, 0.f, 1.f);
+        finalColor = ColorRGB(clampedValue, clampedValue, clampedValue);
+    }
+    if (m_CurrentDisplayMode == DisplayMode::ShadingMode)
+    {
+        PixelShading(pixelVertex, material);
+        finalColor = pixelVertex.color;
+    }
+
+    finalColor.MaxToOne();
+    m_pFramebuffer->SetColor(px + (py * m_Width), finalColor);
+
+    return true;
+}
+
+bool Renderer::RasterizeTriangle(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, const Material& material,
+    int& pixelsShaded, int& fragmentsRejected)
+{
+    ScreenTriangle triangle;
+    if (!SetupTriangle(vertex0, vertex1, vertex2, m_Width, m_Height, triangle)) return false;
+
+    m_pDepthBuffer->VisitFormat([&](auto depthFormat) {
+        int pixelsBroadcast{ 0 };
+        ShadeTriangle<decltype(depthFormat), false>(vertex0, vertex1, vertex2, triangle, material, 1, pixelsShaded, pixelsBroadcast, fragmentsRejected);
+        });
+    return true;
+}
+
+template<typename Format, bool IsMsaa>
+void Renderer::ShadeTriangle(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, const ScreenTriangle& triangle,
+    const Material& material, int shadingRate, int& pixelsShaded, int& pixelsBroadcast, int& fragmentsRejected)
+{
+    // After a depth pass the buffer already holds the nearest depth, only the fragment matching it is shaded.
+    // MSAA only runs in the forward path.
+    const bool isDepthEqual = !IsMsaa && m_CurrentRenderPath == RenderPath::DepthPrepass;
+    typename Format::Texel* pDepth = IsMsaa ? m_SampleDepthBuffer.GetTexels<Format>() : m_pDepthBuffer->GetTexels<Format>();
+
+    // Coarse blocks line up with the screen, each remembers the pixel the triangle was shaded at and the rest of it copies that color
+    const int rateShift = shadingRate == 4 ? 2 : shadingRate == 2 ? 1 : 0;
+    const int firstBlockX = triangle.minX >> rateShift;
+    const int firstBlockY = triangle.minY >> rateShift;
+    const int blockColumns = ((triangle.maxX - 1) >> rateShift) - firstBlockX + 1;
+    std::array<int, (TILE_SIZE / 2) * (TILE_SIZE / 2)> blockSources;
+    if (shadingRate > 1) std::fill_n(blockSources.begin(), blockColumns * (((triangle.maxY - 1) >> rateShift) - firstBlockY + 1), -1);
+
+    for (int py = triangle.minY; py < triangle.maxY; ++py) {
+        for (int px = triangle.minX; px < triangle.maxX; ++px) {
+            const int pixelIndex = px + (py * m_Width);
+            float interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue;
+            // Bit per sample that passed the depth test, the pixel's only one without MSAA
+            int passed{ 0 };
+            if constexpr (IsMsaa) {
+                std::array<float, MSAA_SAMPLES> sampleDepths;
+                const int coverage = ComputeSampleCoverage(triangle, px, py, sampleDepths.data());
+                if (coverage == 0) continue;
+
+                for (int sample = 0; sample < MSAA_SAMPLES; ++sample) {
+                    if (!(coverage & 1 << sample)) continue;
+                    const typename Format::Texel depth = Format::Encode(sampleDepths[sample]);
+                    typename Format::Texel& sampleDepth = pDepth[pixelIndex * MSAA_SAMPLES + sample];
+                    if (depth >= sampleDepth) {
+                        ++fragmentsRejected;
+                        continue;
+                    }
+                    sampleDepth = depth;
+                    passed |= 1 << sample;
+                }
+                if (passed == 0) continue;
+            }
+            else {
+                if (!ComputePixel(triangle, px, py, interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue)) continue;
+
+                const typename Format::Texel depth = Format::Encode(zBufferValue);
+                if (isDepthEqual) {
+                    if (depth != pDepth[pixelIndex]) {
+                        ++fragmentsRejected;
+                        continue;
+                    }
+
+                    // Claim the pixel one step nearer so a coplanar fragment at the same depth is not shaded again
+                    pDepth[pixelIndex] = depth > 0 ? static_cast<typename Format::Texel>(depth - 1) : depth;
+                }
+                else {
+                    if (depth >= pDepth[pixelIndex]) {
+                        ++fragmentsRejected;
+                        continue;
+                    }
+                    pDepth[pixelIndex] = depth;
+                }
+                passed = 1;
+            }
+
+            // With MSAA the float framebuffer holds the pixel's color for this triangle only, the samples keep what they were covered by
+            const auto storeSamples = [&] {
+                if constexpr (IsMsaa) {
+                    const ColorRGB color = m_pFramebuffer->GetColor(pixelIndex);
+                    for (int sample = 0; sample < MSAA_SAMPLES; ++sample) {
+                        if (passed & 1 << sample) m_pSampleFramebuffer->SetColor(pixelIndex * MSAA_SAMPLES + sample, color);
+                    }
+                }
+            };
+
+            int* pBlockSource{};
+            if (shadingRate > 1) {
+                pBlockSource = &blockSources[((py >> rateShift) - firstBlockY) * blockColumns + (px >> rateShift) - firstBlockX];
+                if (*pBlockSource >= 0) {
+                    m_pFramebuffer->SetColor(pixelIndex, m_pFramebuffer->GetColor(*pBlockSource));
+                    storeSamples();
+                    ++pixelsBroadcast;
+                    continue;
+                }
+            }
+
+            if constexpr (IsMsaa) {
+                // Shaded where the triangle covers the pixel, the center may lie outside it and extrapolate the attributes
+                int shadedSample{ 0 };
+                while (!(passed & 1 << shadedSample)) ++shadedSample;
+                if (!ComputePoint(triangle, px + MSAA_SAMPLE_X[shadedSample], py + MSAA_SAMPLE_Y[shadedSample],
+                    interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue)) continue;
+            }
+            if (!ShadePixel(vertex0, vertex1, vertex2, triangle, px, py,
+                interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue, material)) continue;
+            storeSamples();
+            ++pixelsShaded;
+            if (pBlockSource) *pBlockSource = pixelIndex;
+        }
+    }
+}
+
+bool Renderer::RasterizeTriangleDepth(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, uint32_t visibilityId,
+    int& fragmentsRejected)
+{
+    ScreenTriangle triangle;
+    if (!SetupTriangle(vertex0, vertex1, vertex2, m_Width, m_Height, triangle)) return false;
+
+    m_pDepthBuffer->VisitFormat([&](auto depthFormat) {
+        RasterizeDepth<decltype(depthFormat)>(triangle, visibilityId, fragmentsRejected);
+        });
+    return true;
+}
+
+template<typename Format>
+void Renderer::RasterizeDepth(const ScreenTriangle& triangle, uint32_t visibilityId, int& fragmentsRejected)
+{
+    // Same coverage and depth as the color pass so the equality test matches bit for bit
+    typename Format::Texel* pDepth = m_pDepthBuffer->GetTexels<Format>();
+    for (int py = triangle.minY; py < triangle.maxY; ++py) {
+        for (int px = triangle.minX; px < triangle.maxX; ++px) {
+            float interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue;
+            if (!ComputePixel(triangle, px, py, interpolationScale0, interpolationScale1, interpolationScale2, zBufferValue)) continue;
+
+            int pixelIndex = px + (py * m_Width);
+            const typename Format::Texel depth = Format::Encode(zBufferValue);
+            if (depth >= pDepth[pixelIndex]) {
+                ++fragmentsRejected;
+                continue;
+            }
+
+            pDepth[pixelIndex] = depth;
+            if (visibilityId != EMPTY_VISIBILITY) m_VisibilityBuffer[pixelIndex] = visibilityId;
+        }
+    }
+}
+
+void Renderer::PixelShading(Vertex_Out& v, const Material& material)
 {
    // ColorRGB tempColor{ ColorRGB(0.f, 0.f, 0.f)};
 
-    Vector3 lightDirection = { .577f, -.577f,  .577f }; 
+    constexpr Vector3 lightDirection = { .577f, -.577f,  .577f };
     constexpr float lightIntensity = 7.f;
     constexpr float shininess = 25.f;
     constexpr ColorRGB ambient = { .03f,.03f,.03f };
    
-    if (m_IsNormalMap)
+    if (m_IsNormalMap && material.pNormal)
     {
         Vector3 binormal = Vector3::Cross(v.normal, v.tangent);
-        Matrix tangentSpaceAxis = Matrix{ v.tangent, binormal, v.normal, Vector3::Zero};
-
-        ColorRGB normalMapSample = m_NormalMapTexture->Sample(v.uv);
+        ColorRGB normalMapSample = material.pNormal->Sample(v.uv);
         v.normal = (v.tangent * (2.f * normalMapSample.r - 1.f) + binormal * (2.f * normalMapSample.g - 1.f) + v.normal * (2.f * normalMapSample.b - 1.f)).Normalized();
     }
  
@@ -326,12 +1545,13 @@ void Renderer::PixelShading(Vertex_Out& v)
 
     ColorRGB observedArea = { cosOfAngle, cosOfAngle, cosOfAngle };
     
-    ColorRGB diffuse = Lambert(m_DiffuseTexture->Sample(v.uv));
+    // Missing material textures fall back to white diffuse, full gloss and no specular
+    ColorRGB diffuse = Lambert(material.pDiffuse ? material.pDiffuse->Sample(v.uv) : colors::White);
 
-    ColorRGB gloss = m_GlossTexture->Sample(v.uv);
+    ColorRGB gloss = material.pGloss ? material.pGloss->Sample(v.uv) : colors::White;
     float exp = gloss.r * shininess;
 
-    ColorRGB specular = Phong(m_SpecularTexture->Sample(v.uv), exp, -lightDirection, v.viewDirection, v.normal);
+    ColorRGB specular = material.pSpecular ? Phong(material.pSpecular->Sample(v.uv), exp, -lightDirection, v.viewDirection, v.normal) : colors::Black;
 
     switch (m_CurrentShadingMode)
     {
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <array>
+#include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <vector>
 #include <memory>
 #include <functional>
 #include "Camera.h"
 #include "DataTypes.h"
+#include "DepthBuffer.h"
+#include "DynamicResolution.h"
+#include "Framebuffer.h"
+#include "OcclusionBuffer.h"
+#include "SwapChain.h"
+#include "ThreadPool.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -14,14 +23,20 @@ namespace dae
 {
 	class Texture;
 	struct Mesh;
+	struct Meshlet;
+	struct MeshLod;
 	struct Vertex;
+	struct Frustum;
 	class Timer;
 	class Scene;
+	struct Material;
 
 	class Renderer final
 	{
 	public:
 		Renderer(SDL_Window* pWindow);
+		// Renders off screen only, for benchmarks and tools
+		Renderer(int width, int height);
 		~Renderer();
 
 		Renderer(const Renderer&) = delete;
@@ -31,11 +46,22 @@ namespace dae
 
 		void Update(Timer* pTimer);
 		void Render();
+		// Depth to the far plane and the back buffer to the clear color with streaming stores.
+		// Render clears a tile lazily, when the first triangle reaches it, and packs the clear color straight into untouched ones.
+		void ClearBuffers();
 
 		bool SaveBufferToImage() const;
 
-		void VertexTransformationFunction(Mesh& mesh) const;
-		void PixelShading(const Vertex_Out& v);
+		uint32_t SelectLod(const Mesh& mesh, const Matrix& worldMatrix) const;
+		bool IsMeshletCulled(const Meshlet& meshlet, const Matrix& worldMatrix, const Frustum& frustum) const;
+		void VertexTransformationFunction(const Mesh& mesh, const MeshLod& lod, const Meshlet& meshlet, const Matrix& rotatedWorldMatrix, const Matrix& overallMatrix,
+			Vertex_Out* pVerticesOut) const;
+		// Shades into the float framebuffer, Render packs it into the back buffer tile by tile
+		bool RasterizeTriangle(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, const Material& material,
+			int& pixelsShaded, int& fragmentsRejected);
+		// Minimal depth kernel, also stores the visibility id unless it is EMPTY_VISIBILITY
+		bool RasterizeTriangleDepth(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, uint32_t visibilityId,
+			int& fragmentsRejected);
 
 		void ClipTriangle(const Vertex_Out& v0, const Vertex_Out& v1, const Vertex_Out& v2,
 			std::vector<Vertex_Out>& clippedVertices, std::vector<uint32_t>& clippedIndices);
@@ -54,7 +80,7 @@ namespace dae
 			return start2 + (value - start1) * (stop2 - start2) / (stop1 - start1);
 		}
 
-		void PixelShading(Vertex_Out& v);
+		void PixelShading(Vertex_Out& v, const Material& material);
 
 		void SetIsFinalColor(bool isFinalColor)
 		{
@@ -76,6 +102,37 @@ namespace dae
 			return m_IsRotating;
 		}
 
+		void SetIsLodEnabled(bool isLodEnabled)
+		{
+			m_IsLodEnabled = isLodEnabled;
+		}
+
+		bool GetIsLodEnabled() const
+		{
+			return m_IsLodEnabled;
+		}
+
+		void SetIsDepthSorted(bool isDepthSorted)
+		{
+			m_IsDepthSorted = isDepthSorted;
+		}
+
+		bool GetIsDepthSorted() const
+		{
+			return m_IsDepthSorted;
+		}
+
+		void SetIsOcclusionCulling(bool isOcclusionCulling)
+		{
+			m_IsOcclusionCulling = isOcclusionCulling;
+			++m_SceneVersion;
+		}
+
+		bool GetIsOcclusionCulling() const
+		{
+			return m_IsOcclusionCulling;
+		}
+
 		void SetIsNormalMap(bool isNormalMap)
 		{
 			m_IsNormalMap = isNormalMap;
@@ -86,6 +143,107 @@ namespace dae
 			return m_IsNormalMap;
 		}
 
+		// Geometry of the next frame is processed while the current one is rasterized,
+		// so a frame reaches the screen one Render call after its Update
+		void SetIsPipelined(bool isPipelined)
+		{
+			m_IsPipelined = isPipelined;
+			m_IsFramePrepared = false;
+		}
+
+		bool GetIsPipelined() const
+		{
+			return m_IsPipelined;
+		}
+
+		// Render returns without rendering while nothing the image depends on changed since the frame on screen,
+		// which stays presented. Tools that time or capture the same view over and over turn it off.
+		void SetIsFrameSkipping(bool isFrameSkipping)
+		{
+			m_IsFrameSkipping = isFrameSkipping;
+		}
+
+		bool GetIsFrameSkipping() const
+		{
+			return m_IsFrameSkipping;
+		}
+
+		// Render calls that returned without rendering
+		uint64_t GetSkippedFrameCount() const
+		{
+			return m_SkippedFrameCount;
+		}
+
+		// Whether anything the image depends on changed since the frame on screen or the one prepared next, checked after Update.
+		// While it is not, Render has nothing to do and the caller may wait for input instead.
+		bool IsFrameDirty() const;
+
+		// Copies a frame that became due since to the window, once per loop iteration on the thread polling the window's events
+		void UpdateWindow()
+		{
+			m_pSwapChain->ShowReady();
+		}
+
+		// Shows the frame on screen again, for when the window lost its contents
+		void RefreshWindow()
+		{
+			m_pSwapChain->Refresh();
+		}
+
+		// The visibility buffer path reuses last frame's color for pixels whose triangle was seen at the reprojected spot with a matching depth.
+		// A color is reused at most MAX_REUSE_AGE frames in a row before it is shaded again.
+		void SetIsReprojectionCache(bool isReprojectionCache)
+		{
+			m_IsReprojectionCache = isReprojectionCache;
+		}
+
+		bool GetIsReprojectionCache() const
+		{
+			return m_IsReprojectionCache;
+		}
+
+		// Four samples per pixel in the forward path, coverage and depth tested per sample and each pixel shaded once per triangle.
+		// Tiles average their samples when they are resolved. The other paths keep one sample per pixel.
+		void SetIsMsaa(bool isMsaa);
+
+		bool GetIsMsaa() const
+		{
+			return m_IsMsaa;
+		}
+
+		// Depth, color and sample buffers the raster passes write, the swap chain's images aside
+		size_t GetRenderTargetBytes() const;
+
+		void CyclePresentMode()
+		{
+			switch (m_pSwapChain->GetPresentMode())
+			{
+			case SwapChain::PresentMode::Uncapped:
+				std::cout << "Current present mode: VSYNC" << std::endl;
+				m_pSwapChain->SetPresentMode(SwapChain::PresentMode::VSync);
+				break;
+			case SwapChain::PresentMode::VSync:
+				std::cout << "Current present mode: UNCAPPED" << std::endl;
+				m_pSwapChain->SetPresentMode(SwapChain::PresentMode::Uncapped);
+				break;
+			}
+		}
+
+		void SetPresentMode(SwapChain::PresentMode presentMode)
+		{
+			m_pSwapChain->SetPresentMode(presentMode);
+		}
+
+		SwapChain::PresentMode GetPresentMode() const
+		{
+			return m_pSwapChain->GetPresentMode();
+		}
+
+		const SwapChain& GetSwapChain() const
+		{
+			return *m_pSwapChain;
+		}
+
 		enum class DisplayMode {
 			FinalColor,
 			DepthBuffer,
@@ -100,6 +258,69 @@ namespace dae
 			Combined
 		};
 
+		enum class RenderPath
+		{
+			Forward,
+			DepthPrepass,
+			VisibilityBuffer
+		};
+
+		// Shading invocations per pixel, coarse rates shade once per block and triangle and copy the color to the rest of the block.
+		// Coverage and depth stay per pixel at every rate.
+		enum class ShadingRate
+		{
+			Full,
+			Coarse2x2,
+			Coarse4x4,
+			// Per tile from the contrast it had last frame
+			Adaptive
+		};
+
+		enum class SceneType
+		{
+			Vehicle,
+			VehicleGrid,
+			JinxCrowd,
+			ParkingLot,
+			TukTuk
+		};
+
+		struct FrameStats
+		{
+			int instancesTotal{};
+			int instancesCulled{};
+			int instancesOccluded{};
+			int occluders{};
+			bool isOcclusionReprojected{};
+			int meshletsTotal{};
+			int meshletsCulled{};
+			int trianglesRasterized{};
+			int pixelsShaded{};
+			// Fragments that failed the depth test before any shading
+			int fragmentsRejected{};
+			// Pixels that copied the color shaded for their triangle elsewhere in their coarse block
+			int pixelsBroadcast{};
+			// Tiles shaded at 1x1, 2x2 and 4x4
+			int tilesPerShadingRate[3]{};
+			// Pixels looked up in last frame's image by the reprojection cache, and the ones that took their color from it
+			int pixelsReprojected{};
+			int pixelsReused{};
+
+			// Instances and submitted triangles per level of detail
+			int lodInstances[MAX_MESH_LODS]{};
+			int lodTriangles[MAX_MESH_LODS]{};
+
+			// Share of the window's resolution rendered on each axis
+			float renderScale{ 1.f };
+			int renderWidth{};
+			int renderHeight{};
+
+			// Wall time of the Render call that presented the frame, what the worker busy times are measured against
+			int64_t renderNanoseconds{};
+			// From the start of the Render call that processed the frame's geometry until it was queued for present
+			int64_t latencyNanoseconds{};
+		};
+
 		void CycleShadingMode()
 		{
 			switch (m_CurrentShadingMode)
@@ -123,6 +344,16 @@ namespace dae
 			}
 		}
 
+		void SetShadingMode(ShadingMode shadingMode)
+		{
+			m_CurrentShadingMode = shadingMode;
+		}
+
+		ShadingMode GetShadingMode() const
+		{
+			return m_CurrentShadingMode;
+		}
+
 		void SetDisplayMode(DisplayMode displayMode)
 		{
 			m_CurrentDisplayMode = displayMode;
@@ -133,6 +364,209 @@ namespace dae
 			return m_CurrentDisplayMode;
 		}
 
+		void SetScene(SceneType sceneType)
+		{
+			LoadScene(sceneType);
+		}
+
+		SceneType GetScene() const
+		{
+			return m_CurrentScene;
+		}
+
+		void CycleScene()
+		{
+			switch (m_CurrentScene)
+			{
+			case SceneType::Vehicle:
+				std::cout << "Current scene: VEHICLE GRID" << std::endl;
+				LoadScene(SceneType::VehicleGrid);
+				break;
+			case SceneType::VehicleGrid:
+				std::cout << "Current scene: JINX CROWD" << std::endl;
+				LoadScene(SceneType::JinxCrowd);
+				break;
+			case SceneType::JinxCrowd:
+				std::cout << "Current scene: PARKING LOT" << std::endl;
+				LoadScene(SceneType::ParkingLot);
+				break;
+			case SceneType::ParkingLot:
+				std::cout << "Current scene: TUKTUK" << std::endl;
+				LoadScene(SceneType::TukTuk);
+				break;
+			case SceneType::TukTuk:
+				std::cout << "Current scene: VEHICLE" << std::endl;
+				LoadScene(SceneType::Vehicle);
+				break;
+			}
+		}
+
+		void CycleRenderPath()
+		{
+			switch (m_CurrentRenderPath)
+			{
+			case RenderPath::Forward:
+				std::cout << "Current render path: DEPTH PREPASS" << std::endl;
+				m_CurrentRenderPath = RenderPath::DepthPrepass;
+				break;
+			case RenderPath::DepthPrepass:
+				std::cout << "Current render path: VISIBILITY BUFFER" << std::endl;
+				m_CurrentRenderPath = RenderPath::VisibilityBuffer;
+				break;
+			case RenderPath::VisibilityBuffer:
+				std::cout << "Current render path: FORWARD" << std::endl;
+				m_CurrentRenderPath = RenderPath::Forward;
+				break;
+			}
+		}
+
+		void SetRenderPath(RenderPath renderPath)
+		{
+			m_CurrentRenderPath = renderPath;
+		}
+
+		RenderPath GetRenderPath() const
+		{
+			return m_CurrentRenderPath;
+		}
+
+		void CycleShadingRate()
+		{
+			switch (m_ShadingRate)
+			{
+			case ShadingRate::Full:
+				std::cout << "Current shading rate: 2X2" << std::endl;
+				m_ShadingRate = ShadingRate::Coarse2x2;
+				break;
+			case ShadingRate::Coarse2x2:
+				std::cout << "Current shading rate: 4X4" << std::endl;
+				m_ShadingRate = ShadingRate::Coarse4x4;
+				break;
+			case ShadingRate::Coarse4x4:
+				std::cout << "Current shading rate: ADAPTIVE" << std::endl;
+				m_ShadingRate = ShadingRate::Adaptive;
+				break;
+			case ShadingRate::Adaptive:
+				std::cout << "Current shading rate: FULL" << std::endl;
+				m_ShadingRate = ShadingRate::Full;
+				break;
+			}
+		}
+
+		void SetShadingRate(ShadingRate shadingRate)
+		{
+			m_ShadingRate = shadingRate;
+		}
+
+		ShadingRate GetShadingRate() const
+		{
+			return m_ShadingRate;
+		}
+
+		void CycleDepthFormat()
+		{
+			switch (m_DepthFormat)
+			{
+			case DepthFormat::D32F:
+				std::cout << "Current depth format: D16" << std::endl;
+				SetDepthFormat(DepthFormat::D16);
+				break;
+			case DepthFormat::D16:
+				std::cout << "Current depth format: D24" << std::endl;
+				SetDepthFormat(DepthFormat::D24);
+				break;
+			case DepthFormat::D24:
+				std::cout << "Current depth format: D32F" << std::endl;
+				SetDepthFormat(DepthFormat::D32F);
+				break;
+			}
+		}
+
+		// Reallocates both frames' depth buffers, cleared
+		void SetDepthFormat(DepthFormat depthFormat);
+
+		DepthFormat GetDepthFormat() const
+		{
+			return m_DepthFormat;
+		}
+
+		// Reversed-Z keeps D32F precise into the distance, the depth buffers are reallocated for it
+		void SetIsReversedZ(bool isReversedZ);
+
+		bool GetIsReversedZ() const
+		{
+			return m_Camera.isReversedZ;
+		}
+
+		// Projection without a far plane, nothing is culled or clipped by distance
+		void SetIsInfiniteFar(bool isInfiniteFar);
+
+		bool GetIsInfiniteFar() const
+		{
+			return m_Camera.isInfiniteFar;
+		}
+
+		// Share of the window's resolution frames are rendered at on each axis, upscaled to the window when below 1.
+		// The fixed one unless dynamic resolution is on.
+		void SetRenderScale(float renderScale);
+
+		float GetRenderScale() const
+		{
+			return m_IsDynamicResolution ? m_DynamicResolution.GetScale() : m_RenderScale;
+		}
+
+		// Every Update moves the render scale within its bounds to keep frames near the target time, starting from the fixed scale
+		void SetIsDynamicResolution(bool isDynamicResolution)
+		{
+			m_IsDynamicResolution = isDynamicResolution;
+			if (isDynamicResolution) m_DynamicResolution.Reset(m_RenderScale);
+		}
+
+		bool GetIsDynamicResolution() const
+		{
+			return m_IsDynamicResolution;
+		}
+
+		void SetTargetFrameTime(float seconds)
+		{
+			m_DynamicResolution.SetTargetFrameTime(seconds);
+		}
+
+		float GetTargetFrameTime() const
+		{
+			return m_DynamicResolution.GetTargetFrameTime();
+		}
+
+		void SetRenderScaleBounds(float minScale, float maxScale)
+		{
+			m_DynamicResolution.SetScaleBounds(minScale, maxScale);
+		}
+
+		// Fixed orientation of every instance, for reproducible frames
+		void SetRotation(float yaw)
+		{
+			m_MatrixRot = Matrix::CreateRotationY(yaw);
+			++m_SceneVersion;
+		}
+
+		// Valid until the next Render, holds the last presented frame
+		SDL_Surface* GetBackBuffer() const
+		{
+			return m_pBackBuffer;
+		}
+
+		// Of the last presented frame
+		const FrameStats& GetFrameStats() const
+		{
+			return m_Frames[m_DisplayFrame].stats;
+		}
+
+		// Tasks and busy time of every worker during the last Render call
+		const std::vector<ThreadPool::WorkerStats>& GetWorkerStats() const
+		{
+			return m_ThreadPool.GetWorkerStats();
+		}
+
 
 
 		static ColorRGB Lambert(const ColorRGB cd, const float kd = 1)
@@ -153,34 +587,323 @@ namespace dae
 			const Vector3 reflect = l - (2 * std::max(Vector3::Dot(n, l), 0.f) * n);
 			const float cosAlpha = std::max(Vector3::Dot(reflect, v), 0.f);
 
-			return ks * std::powf(cosAlpha, exp);
+			return ks * std::pow(cosAlpha, exp);
 		}
 		
 		
 	private:
+		// Buffers, scene and camera, shared by both constructors
+		void Initialize();
+		void LoadScene(SceneType sceneType);
+		// In the current format and depth direction, cleared
+		void RecreateDepthBuffers();
+
+		struct FrameContext;
+		static constexpr TaskGraph::JobId NO_JOB{ ~TaskGraph::JobId{} };
+		// Culling, sorting, transform and binning of one frame, after the given job unless it is NO_JOB. Returns the last job.
+		TaskGraph::JobId AddGeometryJobs(FrameContext& frame, TaskGraph::JobId after);
+		void AddRasterJobs(FrameContext& frame, TaskGraph::JobId after);
+
+		// Frame task graph stages, one task for the instances, then chunks of meshlet draws and then screen tiles
+		void PrepareFrame(FrameContext& frame);
+		void CullOccludedInstances(FrameContext& frame);
+		void ComputeSortKeys(FrameContext& frame, int chunk);
+		void RadixHistogram(int part, int pass);
+		void RadixPrefixSum();
+		void RadixScatter(FrameContext& frame, int part, int pass);
+		int RadixPartFirst(int part) const;
+		void TransformChunk(FrameContext& frame, int chunk, int worker);
+		void BinChunk(FrameContext& frame, int chunk, int worker);
+		void RasterizeTile(FrameContext& frame, int tile, int worker);
+		void ResolveTile(FrameContext& frame, int tile, int worker);
+		void UpscaleBand(FrameContext& frame, int band, int worker);
+		// Frames below the window's resolution resolve into the scaled image, upscaled into the back buffer afterwards
+		bool IsUpscaled(const FrameContext& frame) const;
+		uint32_t* GetResolvePixels(const FrameContext& frame);
+
+		// Screen space triangle shared by every raster pass, so coverage and depth match bit for bit
+		struct ScreenTriangle
+		{
+			Vector4 v0;
+			Vector4 v1;
+			Vector4 v2;
+			Vector2 edge0;
+			Vector2 edge1;
+			Vector2 edge2;
+			float wProduct;
+			int minX;
+			int maxX;
+			int minY;
+			int maxY;
+		};
+		static Vector4 ProjectVertex(const Vector3& position, const Matrix& overallMatrix);
+		// Viewport of width by height pixels at the top left of the buffers
+		bool SetupTriangle(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, int width, int height, ScreenTriangle& triangle) const;
+		bool ComputePixel(const ScreenTriangle& triangle, int px, int py,
+			float& interpolationScale0, float& interpolationScale1, float& interpolationScale2, float& zBufferValue) const;
+		// ComputePixel at any point of the screen
+		bool ComputePoint(const ScreenTriangle& triangle, float x, float y,
+			float& interpolationScale0, float& interpolationScale1, float& interpolationScale2, float& zBufferValue) const;
+		// Bit per MSAA sample of the pixel the triangle covers with a depth in range, all samples evaluated at once.
+		// Depths are written for every sample, covered or not.
+		int ComputeSampleCoverage(const ScreenTriangle& triangle, int px, int py, float* pSampleDepths) const;
+		bool ShadePixel(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, const ScreenTriangle& triangle, int px, int py,
+			float interpolationScale0, float interpolationScale1, float interpolationScale2, float zBufferValue, const Material& material);
+		// Pixel loops over the triangle's bounding box, which tiles clamp to their own pixels
+		// Depth is tested and written in the texels of Format, the one of the depth buffer being rasterized.
+		// A shading rate above 1 needs the box inside one tile.
+		// With IsMsaa coverage and depth are tested per sample in the sample buffers, the pixel is shaded at the first sample that passed.
+		template<typename Format, bool IsMsaa>
+		void ShadeTriangle(const Vertex_Out& vertex0, const Vertex_Out& vertex1, const Vertex_Out& vertex2, const ScreenTriangle& triangle,
+			const Material& material, int shadingRate, int& pixelsShaded, int& pixelsBroadcast, int& fragmentsRejected);
+		template<typename Format>
+		void RasterizeDepth(const ScreenTriangle& triangle, uint32_t visibilityId, int& fragmentsRejected);
+		bool ClampToTile(ScreenTriangle& triangle, int tile) const;
+		// 1, 2 or 4 pixels per side of the blocks the tile shades once per triangle
+		int SelectShadingRate(int tile) const;
+
+		// Everything a frame's image depends on, frames with the state of the one on screen are skipped
+		struct FrameState
+		{
+			Matrix viewProjection;
+			// Covers the instances' rotation and the scene itself
+			uint32_t sceneVersion{};
+			float renderScale{};
+			DisplayMode displayMode{};
+			ShadingMode shadingMode{};
+			RenderPath renderPath{};
+			ShadingRate shadingRate{};
+			DepthFormat depthFormat{};
+			bool isReversedZ{};
+			bool isNormalMap{};
+			bool isLodEnabled{};
+			bool isDepthSorted{};
+			bool isReprojectionCache{};
+			bool isMsaa{};
+
+			bool operator==(const FrameState&) const = default;
+		};
+		FrameState CaptureFrameState() const;
+		// Whether a frame rendered in state may reuse the colors of the previous one, whose tiles ran in previousState
+		bool IsHistoryReusable(const FrameContext& previous, const FrameState& previousState, const FrameState& state) const;
+
+		// Last frame's color of the surface the pixel shows, when the reprojection cache has it and it was not reused too often already.
+		// reprojection takes the frame's view space to last frame's, colorAge is the age the pixel's color has this frame,
+		// left alone when there is no history for the pixel.
+		bool LookUpHistory(const FrameContext& frame, const Matrix& reprojection, uint64_t triangleKey, int px, int py, float viewDepth,
+			ColorRGB& color, uint8_t& colorAge) const;
+
+		// Identifies a triangle across frames, unlike the visibility id whose draw index changes with culling and sorting
+		// The instance fills the high half, the low one holds level of detail, meshlet and meshlet triangle from the top
+		static uint64_t MakeTriangleKey(uint32_t instanceIndex, uint32_t lod, uint32_t meshlet, uint32_t triangle)
+		{
+			assert(lod < (1u << (32 - TRIANGLE_KEY_LOD_SHIFT)));
+			assert(meshlet < (1u << TRIANGLE_KEY_MESHLET_BITS));
+			assert(triangle <= VISIBILITY_TRIANGLE_MASK);
+			return uint64_t{ instanceIndex } << 32 | uint64_t{ lod } << TRIANGLE_KEY_LOD_SHIFT
+				| uint64_t{ meshlet } << VISIBILITY_TRIANGLE_BITS | uint64_t{ triangle };
+		}
 
 		ShadingMode m_CurrentShadingMode{ ShadingMode::Combined };
 		DisplayMode m_CurrentDisplayMode{ DisplayMode::ShadingMode };
+		RenderPath m_CurrentRenderPath{ RenderPath::Forward };
+		ShadingRate m_ShadingRate{ ShadingRate::Full };
 
 		SDL_Window* m_pWindow{};
 		bool m_IsFinalColor { true };
 		bool m_IsRotating{ true };
 		bool m_IsNormalMap{ true };
+		bool m_IsLodEnabled{ true };
+		float m_LodPixelError{ 1.f };
+		bool m_IsOcclusionCulling{ true };
+		bool m_IsDepthSorted{ true };
+		bool m_IsPipelined{ true };
+		bool m_IsFrameSkipping{ true };
+		uint64_t m_SkippedFrameCount{};
+		// State of the last Render call that rendered, what the tiles of the frame on screen were shaded with
+		FrameState m_RenderedState{};
+		bool m_IsReprojectionCache{};
+		bool m_IsMsaa{};
+
+		// Bumped whenever instances move or the scene changes, the occlusion history only seeds frames of the same version
+		uint32_t m_SceneVersion{};
+		uint32_t m_OcclusionHistoryVersion{};
+		bool m_HasOcclusionHistory{};
+
+		SceneType m_CurrentScene{ SceneType::Vehicle };
+
+		std::unique_ptr<Scene> m_pScene;
+		Matrix m_MatrixRot;
 
-		Texture* m_DiffuseTexture;
-		Texture* m_NormalMapTexture;
-		Texture* m_GlossTexture;
-		Texture* m_SpecularTexture;
+		// Work items of a frame, kept in its FrameContext
+		struct VisibleInstance
+		{
+			Matrix worldMatrix;
+			Matrix worldViewProjectionMatrix;
+			uint32_t instanceIndex;
+			uint32_t lod;
+		};
+		struct MeshletDraw
+		{
+			uint32_t visibleInstance;
+			uint32_t meshlet;
+			// First of this draw's vertices in the frame's transformed vertices
+			uint32_t vertexOffset;
+		};
 
-		std::vector<Mesh> m_MeshesWorld;
-		Matrix m_MatrixRot;
-		
+		// Radix sort scratch, 16 bit depth keys sorted one byte per pass.
+		// Passes alternate between the frame's lists and these, an even count ends back in the frame's.
+		static constexpr int RADIX_BITS{ 8 };
+		static constexpr int RADIX_BUCKETS{ 1 << RADIX_BITS };
+		static constexpr int RADIX_PASSES{ 16 / RADIX_BITS };
+		static_assert(RADIX_PASSES % 2 == 0, "The last radix pass has to scatter back into the frame's draws");
+		std::vector<uint16_t> m_DrawDepthKeys;
+		std::vector<uint16_t> m_SortedDepthKeys;
+		std::vector<MeshletDraw> m_SortedDraws;
+		std::vector<uint32_t> m_RadixOffsets;
+
+		// Only the largest instances on screen are drawn into the occlusion buffer
+		static constexpr size_t MAX_OCCLUDERS{ 16 };
+		static constexpr float MIN_OCCLUDER_SCREEN_RADIUS{ 32.f };
+		struct OccluderCandidate
+		{
+			float screenRadius;
+			uint32_t visibleInstance;
+		};
+		std::vector<OccluderCandidate> m_OccluderCandidates;
+		OcclusionBuffer m_OcclusionBuffer{};
+
+		// Persistent workers and the graph they run every frame
+		ThreadPool m_ThreadPool{};
+		TaskGraph m_FrameGraph{};
+		static constexpr int DRAWS_PER_CHUNK{ 32 };
+		static constexpr int TILE_SIZE{ 32 };
+		int m_TileCountX{};
+		int m_TileCountY{};
+
+		// Merged bins of the tile each worker is rasterizing
+		std::vector<std::vector<uint32_t>> m_TileTriangles;
+
+		// Statistics each worker adds up on its own, summed after the frame
+		struct alignas(64) WorkerCounters
+		{
+			int meshletsCulled;
+			int trianglesRasterized;
+			int pixelsShaded;
+			int fragmentsRejected;
+			int pixelsBroadcast;
+			int tilesPerShadingRate[3];
+			int pixelsReprojected;
+			int pixelsReused;
+			int lodTriangles[MAX_MESH_LODS];
+		};
 
-		SDL_Surface* m_pFrontBuffer{ nullptr };
+		// Everything one frame owns from culling to present apart from its image, which comes from the swap chain.
+		// Two of them, so the next frame's geometry is processed while this one is rasterized.
+		struct FrameContext
+		{
+			DepthBuffer depthBuffer;
+			// Per tile, whether its depth still holds the far plane, so tiles nothing reaches are not cleared again
+			std::vector<uint8_t> isTileDepthCleared;
+
+			// Work lists, cleared but never shrunk so steady state rendering does not allocate
+			std::vector<VisibleInstance> visibleInstances;
+			std::vector<MeshletDraw> meshletDraws;
+			// Set by the transform stage for meshlets the bin stage skips
+			std::vector<uint8_t> isDrawCulled;
+			// Vertices of every meshlet drawn, at each draw's vertexOffset
+			std::vector<Vertex_Out> transformedVertices;
+			// Triangle ids per tile, one list per worker so binning never locks, merged back into draw order by the tile
+			std::vector<std::vector<uint32_t>> tileBins;
+			std::vector<WorkerCounters> workerCounters;
+
+			// State the geometry was processed with
+			FrameState state{};
+			Matrix viewProjection;
+			Matrix view;
+			Matrix projection;
+			// Rotation of every instance, the reprojection cache follows their motion with it
+			Matrix rotation;
+			bool isReversedZ{};
+			// Pixels rendered, at the top left of buffers sized for the window
+			int renderWidth{};
+			int renderHeight{};
+			uint32_t sceneVersion{};
+			std::chrono::steady_clock::time_point startTime{};
+			FrameStats stats{};
+
+			// Reprojection cache history, kept by the resolve pass of frames at full resolution with the cache on.
+			// The colors are the frame's presented image.
+			bool hasHistory{};
+			// MakeTriangleKey of the triangle shaded per pixel, EMPTY_TRIANGLE_KEY where there is none
+			std::vector<uint64_t> triangleKeys;
+			// Frames in a row each pixel's color was reused
+			std::vector<uint8_t> colorAges;
+		};
+		std::array<FrameContext, 2> m_Frames{};
+		// Holds the last presented frame, the other one is rasterized next
+		int m_DisplayFrame{};
+		// The other frame's geometry was processed by the last Render call
+		bool m_IsFramePrepared{};
+
+		std::unique_ptr<SwapChain> m_pSwapChain;
+		// Buffers of the frame being rasterized, the last presented one's in between
 		SDL_Surface* m_pBackBuffer{ nullptr };
 		uint32_t* m_pBackBufferPixels{};
-
-		float* m_pDepthBufferPixels{};
+		DepthBuffer* m_pDepthBuffer{};
+		DepthFormat m_DepthFormat{ DepthFormat::D32F };
+		// Colors of the frame being rasterized until its tiles are resolved into the back buffer
+		std::unique_ptr<Framebuffer> m_pFramebuffer;
+		// Standard 4x rotated grid, no two samples share a row or a column so near vertical and near horizontal edges both get four steps
+		static constexpr int MSAA_SAMPLES{ 4 };
+		static constexpr std::array<float, MSAA_SAMPLES> MSAA_SAMPLE_X{ .375f, .875f, .125f, .625f };
+		static constexpr std::array<float, MSAA_SAMPLES> MSAA_SAMPLE_Y{ .125f, .375f, .625f, .875f };
+		// Samples of each pixel side by side, only while MSAA is on. Cleared by every tile that is written, so both frames share them.
+		// The frame's depth buffer gets the farthest sample of each pixel for the occlusion history,
+		// the float framebuffer the average the tile packs into the back buffer.
+		DepthBuffer m_SampleDepthBuffer{};
+		std::unique_ptr<Framebuffer> m_pSampleFramebuffer;
+		// Colors of frames rendered below the window's resolution, upscaled into the back buffer in bands of rows
+		std::vector<uint32_t> m_ScaledPixels;
+		static constexpr int UPSCALE_ROWS{ 16 };
+		// Row of the upscale each worker is filtering
+		std::vector<std::vector<int16_t>> m_UpscaleRows;
+		float m_RenderScale{ 1.f };
+		bool m_IsDynamicResolution{};
+		DynamicResolution m_DynamicResolution{};
+		// Half a step above 100 so the truncation at resolve lands on 100 exactly
+		static constexpr ColorRGB CLEAR_COLOR{ 100.5f / 255.f, 100.5f / 255.f, 100.5f / 255.f };
+
+		// Draw index and meshlet triangle of the nearest fragment per pixel, the same id the tile bins hold
+		static constexpr uint32_t VISIBILITY_TRIANGLE_BITS{ 7 };
+		static constexpr uint32_t VISIBILITY_TRIANGLE_MASK{ (1u << VISIBILITY_TRIANGLE_BITS) - 1 };
+		static constexpr uint32_t EMPTY_VISIBILITY{ 0xFFFFFFFF };
+		static_assert(MAX_MESHLET_TRIANGLES <= (1u << VISIBILITY_TRIANGLE_BITS), "Meshlet triangles must fit the visibility id");
+		// Only read within the Render call that wrote it, so both frames share one
+		std::vector<uint32_t> m_VisibilityBuffer;
+		// Per tile, whether it still holds only EMPTY_VISIBILITY, the resolve pass skips those
+		std::vector<uint8_t> m_IsTileVisibilityCleared;
+
+		static constexpr uint64_t EMPTY_TRIANGLE_KEY{ ~uint64_t{} };
+		static constexpr uint32_t TRIANGLE_KEY_LOD_SHIFT{ 30 };
+		static constexpr uint32_t TRIANGLE_KEY_MESHLET_BITS{ TRIANGLE_KEY_LOD_SHIFT - VISIBILITY_TRIANGLE_BITS };
+		static_assert(MAX_MESH_LODS <= (1u << (32 - TRIANGLE_KEY_LOD_SHIFT)), "Levels of detail must fit the triangle key");
+		// Colors reused this many frames in a row are shaded again. Pixels shaded for lack of history start partway,
+		// so after a cut the refreshes spread over the next frames instead of all landing on one.
+		static constexpr uint8_t MAX_REUSE_AGE{ 3 };
+		// View depth may differ by this share and still count as the same surface
+		static constexpr float REUSE_DEPTH_TOLERANCE{ .01f };
+		// Set by Render while the frame being resolved reprojects into the last presented one, its state copied before the other frame's geometry overwrites it
+		const FrameContext* m_pHistoryFrame{};
+		Matrix m_HistoryView;
+		Matrix m_HistoryProjection;
+		Matrix m_HistoryRotation;
+		const uint32_t* m_pHistoryPixels{};
+
+		// Per tile, Framebuffer::GetContrast of its last shaded frame, adaptive shading goes coarse below these
+		std::vector<float> m_TileContrast;
+		static constexpr float COARSE_2X2_CONTRAST{ .02f };
+		static constexpr float COARSE_4X4_CONTRAST{ .008f };
 
 		Camera m_Camera{};
 
@@ -0,0 +1,81 @@
+#include "Scene.h"
+
+#include "MeshSimplifier.h"
+#include "Texture.h"
+#include "Utils.h"
+
+namespace dae
+{
+	Scene::~Scene()
+	{
+		for (auto& texture : m_TextureCache)
+		{
+			delete texture.second;
+		}
+	}
+
+	uint32_t Scene::LoadMesh(const std::string& path)
+	{
+		const auto it = m_MeshCache.find(path);
+		if (it != m_MeshCache.end()) return it->second;
+
+		Mesh& mesh = m_Meshes.emplace_back();
+		Utils::ParseOBJ(path, mesh.vertices, mesh.indices);
+
+		mesh.primitiveTopology = PrimitiveTopology::TriangleList;
+		mesh.CalculateBounds();
+
+		// Levels of detail are generated once at load time, each halving the triangle count of the previous one
+		MeshLod& fullDetail = mesh.lods.emplace_back();
+		fullDetail.indices = mesh.indices;
+		while (mesh.lods.size() < MAX_MESH_LODS)
+		{
+			const MeshLod& previous = mesh.lods.back();
+			MeshLod lod{};
+			lod.indices = SimplifyMesh(mesh.vertices, mesh.indices, previous.indices.size() / 6 * 3, &lod.error);
+
+			// Stop once the simplifier gets stuck on locked borders and seams
+			if (lod.indices.size() * 10 > previous.indices.size() * 9) break;
+			mesh.lods.push_back(std::move(lod));
+		}
+
+		for (MeshLod& lod : mesh.lods)
+		{
+			Utils::BuildMeshlets(mesh, lod);
+		}
+
+		const uint32_t meshIndex = static_cast<uint32_t>(m_Meshes.size()) - 1;
+		m_MeshCache.emplace(path, meshIndex);
+		return meshIndex;
+	}
+
+	uint32_t Scene::AddMaterial(const std::string& diffusePath, const std::string& normalPath, const std::string& glossPath, const std::string& specularPath)
+	{
+		m_Materials.push_back({ LoadTexture(diffusePath), LoadTexture(normalPath), LoadTexture(glossPath), LoadTexture(specularPath) });
+		return static_cast<uint32_t>(m_Materials.size()) - 1;
+	}
+
+	uint32_t Scene::AddInstance(uint32_t meshIndex, uint32_t materialIndex, const Matrix& worldMatrix)
+	{
+		m_Instances.push_back({ meshIndex, materialIndex, worldMatrix });
+		return static_cast<uint32_t>(m_Instances.size()) - 1;
+	}
+
+	void Scene::Clear()
+	{
+		m_Instances.clear();
+		m_Materials.clear();
+	}
+
+	Texture* Scene::LoadTexture(const std::string& path)
+	{
+		if (path.empty()) return nullptr;
+
+		const auto it = m_TextureCache.find(path);
+		if (it != m_TextureCache.end()) return it->second;
+
+		Texture* pTexture = Texture::LoadFromFile(path);
+		m_TextureCache.emplace(path, pTexture);
+		return pTexture;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DataTypes.h"
+
+namespace dae
+{
+	class Texture;
+
+	struct Material
+	{
+		Texture* pDiffuse{};
+		Texture* pNormal{};
+		Texture* pGloss{};
+		Texture* pSpecular{};
+	};
+
+	// Lightweight placement of a shared mesh asset
+	struct MeshInstance
+	{
+		uint32_t meshIndex{};
+		uint32_t materialIndex{};
+		Matrix worldMatrix{};
+	};
+
+	class Scene final
+	{
+	public:
+		Scene() = default;
+		~Scene();
+
+		Scene(const Scene&) = delete;
+		Scene(Scene&&) noexcept = delete;
+		Scene& operator=(const Scene&) = delete;
+		Scene& operator=(Scene&&) noexcept = delete;
+
+		// Assets are loaded once per path and shared by every instance referencing them
+		uint32_t LoadMesh(const std::string& path);
+		// Empty texture paths leave that material slot empty
+		uint32_t AddMaterial(const std::string& diffusePath, const std::string& normalPath, const std::string& glossPath, const std::string& specularPath);
+		uint32_t AddInstance(uint32_t meshIndex, uint32_t materialIndex, const Matrix& worldMatrix);
+
+		// Drops instances and materials, cached meshes and textures stay loaded
+		void Clear();
+
+		const std::vector<Mesh>& GetMeshes() const { return m_Meshes; }
+		const std::vector<Material>& GetMaterials() const { return m_Materials; }
+		const std::vector<MeshInstance>& GetInstances() const { return m_Instances; }
+
+	private:
+		Texture* LoadTexture(const std::string& path);
+
+		std::vector<Mesh> m_Meshes{};
+		std::vector<Material> m_Materials{};
+		std::vector<MeshInstance> m_Instances{};
+
+		std::unordered_map<std::string, uint32_t> m_MeshCache{};
+		std::unordered_map<std::string, Texture*> m_TextureCache{};
+	};
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// Compile-time math back end, picked by the RASTERIZER_SIMD CMake option.
+// Without the option the widest level the compiler targets is used.
+#define DAE_SIMD_NONE 0
+#define DAE_SIMD_SSE 1
+#define DAE_SIMD_AVX 2
+
+#ifndef DAE_SIMD_LEVEL
+#if defined(__AVX__)
+#define DAE_SIMD_LEVEL DAE_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DAE_SIMD_LEVEL DAE_SIMD_SSE
+#else
+#define DAE_SIMD_LEVEL DAE_SIMD_NONE
+#endif
+#endif
+
+#if DAE_SIMD_LEVEL >= DAE_SIMD_AVX
+#include <immintrin.h>
+#elif DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+#include <emmintrin.h>
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "Simd.h"
+
+namespace dae
+{
+	// Fills a rectangle of a 16 or 32-bit image with non-temporal stores, which write around the cache.
+	// Only worth it for memory nothing reads again soon, like a back buffer waiting to be presented.
+	// Ends with a store fence: streaming stores are not ordered by the locks and atomics that hand the image on.
+	template<typename T>
+	void StreamFill(T* pImage, int stride, int x, int y, int width, int height, T value)
+	{
+		static_assert(sizeof(T) == sizeof(uint16_t) || sizeof(T) == sizeof(uint32_t), "Streams 16 or 32-bit pixels");
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+		constexpr int PIXELS_PER_STORE{ 16 / sizeof(T) };
+		__m128i pixels{};
+		if constexpr (sizeof(T) == sizeof(uint16_t))
+		{
+			uint16_t bits{};
+			std::memcpy(&bits, &value, sizeof(bits));
+			pixels = _mm_set1_epi16(static_cast<short>(bits));
+		}
+		else
+		{
+			uint32_t bits{};
+			std::memcpy(&bits, &value, sizeof(bits));
+			pixels = _mm_set1_epi32(static_cast<int>(bits));
+		}
+#endif
+
+		for (int row = y; row < y + height; ++row)
+		{
+			T* pRow = pImage + static_cast<size_t>(row) * stride + x;
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+			// Plain stores up to the first 16-byte boundary, streamed after that
+			int column = 0;
+			for (; column < width && reinterpret_cast<uintptr_t>(pRow + column) % 16 != 0; ++column)
+			{
+				pRow[column] = value;
+			}
+			for (; column + PIXELS_PER_STORE <= width; column += PIXELS_PER_STORE)
+			{
+				_mm_stream_si128(reinterpret_cast<__m128i*>(pRow + column), pixels);
+			}
+			for (; column < width; ++column)
+			{
+				pRow[column] = value;
+			}
+#else
+			std::fill_n(pRow, width, value);
+#endif
+		}
+
+#if DAE_SIMD_LEVEL >= DAE_SIMD_SSE
+		_mm_sfence();
+#endif
+	}
+}
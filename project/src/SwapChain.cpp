@@ -0,0 +1,222 @@
+#include "SwapChain.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "SDL.h"
+#include "SDL_surface.h"
+
+namespace dae
+{
+	SwapChain::SwapChain(SDL_Window* pWindow, int width, int height) :
+		m_pWindow(pWindow)
+	{
+		// The format Framebuffer::Resolve writes
+		for (SDL_Surface*& pImage : m_Images)
+		{
+			pImage = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_XRGB8888);
+		}
+		m_ImageStates.fill(ImageState::Free);
+
+		if (!m_pWindow) return;
+
+		// Window surfaces have no vertical sync of their own, frames are paced to the display's refresh rate instead
+		SDL_DisplayMode displayMode{};
+		const int refreshRate = SDL_GetWindowDisplayMode(m_pWindow, &displayMode) == 0 && displayMode.refresh_rate > 0 ? displayMode.refresh_rate : 60;
+		m_RefreshInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1. / refreshRate));
+
+		const Uint32 readyEvent = SDL_RegisterEvents(1);
+		if (readyEvent != static_cast<Uint32>(-1)) m_ReadyEvent = readyEvent;
+		m_PresentThread = std::thread{ &SwapChain::PresentLoop, this };
+	}
+
+	SwapChain::~SwapChain()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_Condition.notify_all();
+		if (m_PresentThread.joinable()) m_PresentThread.join();
+
+		for (SDL_Surface* pImage : m_Images)
+		{
+			SDL_FreeSurface(pImage);
+		}
+	}
+
+	SDL_Surface* SwapChain::Acquire()
+	{
+		std::unique_lock lock{ m_Mutex };
+		int image{ -1 };
+		while (true)
+		{
+			// In vsync mode every image can be queued, showing the one due frees the image it replaces
+			m_Condition.wait(lock, [&]
+				{
+					const auto free = std::find(m_ImageStates.begin(), m_ImageStates.end(), ImageState::Free);
+					image = static_cast<int>(free - m_ImageStates.begin());
+					return free != m_ImageStates.end() || m_ReadyImage >= 0;
+				});
+			if (m_ReadyImage < 0) break;
+
+			lock.unlock();
+			ShowReady();
+			lock.lock();
+		}
+
+		m_ImageStates[image] = ImageState::Rendering;
+		return m_Images[image];
+	}
+
+	void SwapChain::Present(SDL_Surface* pImage)
+	{
+		const int image = FindImage(pImage);
+		bool isShowing{};
+		{
+			std::lock_guard lock{ m_Mutex };
+			assert(m_ImageStates[image] == ImageState::Rendering);
+
+			if (!m_pWindow)
+			{
+				// Nothing to copy to, the image is on screen right away
+				if (m_OnScreenImage >= 0) m_ImageStates[m_OnScreenImage] = ImageState::Free;
+				m_ImageStates[image] = ImageState::OnScreen;
+				m_OnScreenImage = image;
+				m_PresentedCount.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			if (m_PresentMode == PresentMode::Uncapped)
+			{
+				// Only the newest frame is worth showing when not waiting for the display, frames still queued from vsync mode are dropped
+				for (const int dropped : m_Queue)
+				{
+					m_ImageStates[dropped] = ImageState::Free;
+					m_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+				}
+				m_Queue.clear();
+				if (m_ReadyImage >= 0)
+				{
+					m_ImageStates[m_ReadyImage] = ImageState::Free;
+					m_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				m_ImageStates[image] = ImageState::Ready;
+				m_ReadyImage = image;
+				isShowing = true;
+			}
+			else
+			{
+				m_ImageStates[image] = ImageState::Queued;
+				m_Queue.push_back(image);
+			}
+		}
+		m_Condition.notify_all();
+
+		if (isShowing) ShowReady();
+	}
+
+	void SwapChain::ShowReady()
+	{
+		int image{};
+		{
+			std::lock_guard lock{ m_Mutex };
+			if (m_ReadyImage < 0) return;
+
+			// The window surface keeps its own copy, so the image shown so far can be rendered to again
+			image = m_ReadyImage;
+			m_ReadyImage = -1;
+			if (m_OnScreenImage >= 0) m_ImageStates[m_OnScreenImage] = ImageState::Free;
+			m_ImageStates[image] = ImageState::OnScreen;
+			m_OnScreenImage = image;
+		}
+		// The present thread may hand over the next image, and an Acquire on another image may go ahead
+		m_Condition.notify_all();
+
+		Show(image);
+		m_PresentedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void SwapChain::Refresh()
+	{
+		if (!m_pWindow) return;
+
+		int image{};
+		{
+			std::lock_guard lock{ m_Mutex };
+			image = m_OnScreenImage;
+		}
+		// Only this thread frees the image on screen, by showing another one
+		if (image >= 0) Show(image);
+	}
+
+	void SwapChain::SetPresentMode(PresentMode presentMode)
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_PresentMode = presentMode;
+	}
+
+	SwapChain::PresentMode SwapChain::GetPresentMode() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_PresentMode;
+	}
+
+	void SwapChain::PresentLoop()
+	{
+		auto nextRefresh = std::chrono::steady_clock::now();
+		while (true)
+		{
+			{
+				// One image is handed over at a time, the next waits until that one is on screen
+				std::unique_lock lock{ m_Mutex };
+				m_Condition.wait(lock, [&] { return m_IsStopping || (!m_Queue.empty() && m_ReadyImage < 0); });
+				if (m_IsStopping) return;
+			}
+
+			std::this_thread::sleep_until(nextRefresh);
+
+			{
+				std::lock_guard lock{ m_Mutex };
+				if (m_IsStopping) return;
+				// Switching to uncapped mode meanwhile drops the queue or shows a newer image
+				if (m_Queue.empty() || m_ReadyImage >= 0) continue;
+
+				m_ReadyImage = m_Queue.front();
+				m_Queue.pop_front();
+				m_ImageStates[m_ReadyImage] = ImageState::Ready;
+			}
+			m_Condition.notify_all();
+
+			// Wakes the event loop, which may be waiting for input, to show it
+			if (m_ReadyEvent != 0)
+			{
+				SDL_Event event{};
+				event.type = m_ReadyEvent;
+				SDL_PushEvent(&event);
+			}
+
+			// First refresh after now, a frame that missed one is shown at the next
+			const auto now = std::chrono::steady_clock::now();
+			while (nextRefresh <= now) nextRefresh += m_RefreshInterval;
+		}
+	}
+
+	void SwapChain::Show(int image)
+	{
+		// Fetched every time, resizing the window replaces its surface
+		SDL_Surface* pWindowSurface = SDL_GetWindowSurface(m_pWindow);
+		if (!pWindowSurface) return;
+
+		SDL_BlitSurface(m_Images[image], nullptr, pWindowSurface, nullptr);
+		SDL_UpdateWindowSurface(m_pWindow);
+	}
+
+	int SwapChain::FindImage(const SDL_Surface* pImage) const
+	{
+		const auto found = std::find(m_Images.begin(), m_Images.end(), pImage);
+		assert(found != m_Images.end());
+		return static_cast<int>(found - m_Images.begin());
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct SDL_Window;
+struct SDL_Surface;
+
+namespace dae
+{
+	// Three framebuffers and a present thread pacing finished ones to the display, so rendering the next frame
+	// starts while the last one is still waiting for its refresh. SDL only allows window calls on the thread polling
+	// the window's events, so that thread copies the images the present thread hands over. Without a window images
+	// are presented right away.
+	class SwapChain final
+	{
+	public:
+		enum class PresentMode
+		{
+			// Every frame is shown, one per display refresh, rendering waits when all images are queued
+			VSync,
+			// Shown as soon as they are presented, rendering never waits
+			Uncapped
+		};
+
+		SwapChain(SDL_Window* pWindow, int width, int height);
+		~SwapChain();
+
+		SwapChain(const SwapChain&) = delete;
+		SwapChain(SwapChain&&) noexcept = delete;
+		SwapChain& operator=(const SwapChain&) = delete;
+		SwapChain& operator=(SwapChain&&) noexcept = delete;
+
+		// The calls below touch the window and belong on the thread polling its events
+
+		// Image to render the next frame into, not shown or read until it is presented.
+		// Shows images the present thread hands over while waiting for one to free up.
+		SDL_Surface* Acquire();
+		// Queues the acquired image, it stays untouched until the next image is shown
+		void Present(SDL_Surface* pImage);
+		// Copies the image the present thread handed over to the window, if there is one.
+		// The present thread pushes an SDL event whenever it hands one over, so a loop waiting for events wakes up for it.
+		void ShowReady();
+		// Copies the image on screen to the window again after the window lost its contents
+		void Refresh();
+
+		void SetPresentMode(PresentMode presentMode);
+		PresentMode GetPresentMode() const;
+
+		// Frames copied to the window, and frames replaced before they got there
+		uint64_t GetPresentedCount() const
+		{
+			return m_PresentedCount.load(std::memory_order_relaxed);
+		}
+		uint64_t GetDroppedCount() const
+		{
+			return m_DroppedCount.load(std::memory_order_relaxed);
+		}
+
+	private:
+		static constexpr int IMAGE_COUNT{ 3 };
+		enum class ImageState
+		{
+			Free,
+			Rendering,
+			Queued,
+			// Due on screen, handed over by the present thread
+			Ready,
+			// Freed once a newer image replaces it on screen
+			OnScreen
+		};
+
+		void PresentLoop();
+		// Blits the image to the window, on the thread polling its events
+		void Show(int image);
+		int FindImage(const SDL_Surface* pImage) const;
+
+		SDL_Window* m_pWindow{};
+		// Event type pushed when an image is handed over, zero when SDL had none left to register
+		uint32_t m_ReadyEvent{};
+		std::array<SDL_Surface*, IMAGE_COUNT> m_Images{};
+		std::array<ImageState, IMAGE_COUNT> m_ImageStates{};
+		std::deque<int> m_Queue;
+		int m_ReadyImage{ -1 };
+		int m_OnScreenImage{ -1 };
+		PresentMode m_PresentMode{ PresentMode::Uncapped };
+		std::chrono::steady_clock::duration m_RefreshInterval{};
+
+		// Guards everything above the counters, signalled whenever an image changes state
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_IsStopping{};
+		std::thread m_PresentThread;
+
+		std::atomic<uint64_t> m_PresentedCount{};
+		std::atomic<uint64_t> m_DroppedCount{};
+	};
+}
@@ -0,0 +1,226 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		void PinThread(std::thread& thread, int core)
+		{
+#if defined(_WIN32)
+			if (core < 64) SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{ 1 } << core);
+#elif defined(__linux__)
+			cpu_set_t cores;
+			CPU_ZERO(&cores);
+			CPU_SET(core, &cores);
+			pthread_setaffinity_np(thread.native_handle(), sizeof(cores), &cores);
+#else
+			(void)thread;
+			(void)core;
+#endif
+		}
+	}
+
+	TaskGraph::JobId TaskGraph::AddJob(int taskCount, TaskFunction function)
+	{
+		m_Jobs.push_back({ std::max(taskCount, 0), std::move(function), {}, 0 });
+		return static_cast<JobId>(m_Jobs.size() - 1);
+	}
+
+	void TaskGraph::AddDependency(JobId before, JobId after)
+	{
+		assert(before < m_Jobs.size() && after < m_Jobs.size() && before != after);
+		m_Jobs[before].successors.push_back(after);
+		++m_Jobs[after].dependencyCount;
+	}
+
+	void TaskGraph::SetTaskCount(JobId job, int taskCount)
+	{
+		assert(job < m_Jobs.size());
+		m_Jobs[job].taskCount = std::max(taskCount, 0);
+	}
+
+	void TaskGraph::Clear()
+	{
+		m_Jobs.clear();
+	}
+
+	ThreadPool::ThreadPool(int workerCount) :
+		m_WorkerCount(workerCount > 0 ? workerCount : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))),
+		m_Queues(m_WorkerCount),
+		m_WorkerStats(m_WorkerCount)
+	{
+		// Worker 0 is whichever thread calls Run, the others get a core each
+		const int coreCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+		m_Threads.reserve(m_WorkerCount - 1);
+		for (int worker = 1; worker < m_WorkerCount; ++worker)
+		{
+			m_Threads.emplace_back(&ThreadPool::WorkerLoop, this, worker);
+			PinThread(m_Threads.back(), worker % coreCount);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock{ m_WakeMutex };
+			m_IsStopping = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& thread : m_Threads) thread.join();
+	}
+
+	void ThreadPool::Run(TaskGraph& graph)
+	{
+		const size_t jobCount = graph.m_Jobs.size();
+		if (jobCount == 0) return;
+
+		if (graph.m_CounterCapacity < jobCount)
+		{
+			graph.m_pRemainingTasks = std::make_unique<std::atomic<int>[]>(jobCount);
+			graph.m_pRemainingDependencies = std::make_unique<std::atomic<int>[]>(jobCount);
+			graph.m_CounterCapacity = jobCount;
+		}
+		for (size_t job = 0; job < jobCount; ++job)
+		{
+			graph.m_pRemainingDependencies[job].store(graph.m_Jobs[job].dependencyCount, std::memory_order_relaxed);
+		}
+		m_RemainingJobs.store(static_cast<int>(jobCount));
+
+		for (size_t job = 0; job < jobCount; ++job)
+		{
+			if (graph.m_Jobs[job].dependencyCount == 0) ReleaseJob(graph, static_cast<TaskGraph::JobId>(job), 0);
+		}
+
+		{
+			std::lock_guard lock{ m_WakeMutex };
+			++m_Generation;
+		}
+		m_WakeCondition.notify_all();
+
+		RunTasks(0);
+	}
+
+	void ThreadPool::ParallelFor(int taskCount, const TaskGraph::TaskFunction& function)
+	{
+		m_ParallelForGraph.Clear();
+		m_ParallelForGraph.AddJob(taskCount, function);
+		Run(m_ParallelForGraph);
+	}
+
+	void ThreadPool::ResetStats()
+	{
+		std::fill(m_WorkerStats.begin(), m_WorkerStats.end(), WorkerStats{});
+	}
+
+	void ThreadPool::WorkerLoop(int worker)
+	{
+		uint64_t generation{};
+		while (true)
+		{
+			{
+				std::unique_lock lock{ m_WakeMutex };
+				m_WakeCondition.wait(lock, [&] { return m_IsStopping || m_Generation != generation; });
+				if (m_IsStopping) return;
+				generation = m_Generation;
+			}
+
+			RunTasks(worker);
+		}
+	}
+
+	void ThreadPool::RunTasks(int worker)
+	{
+		Task task;
+		while (m_RemainingJobs.load(std::memory_order_acquire) > 0)
+		{
+			if (PopTask(worker, task) || StealTask(worker, task)) ExecuteTask(task, worker);
+			else std::this_thread::yield();
+		}
+	}
+
+	bool ThreadPool::PopTask(int worker, Task& task)
+	{
+		TaskQueue& queue = m_Queues[worker];
+		std::lock_guard lock{ queue.mutex };
+		if (queue.tasks.empty()) return false;
+
+		// Newest first, its data is most likely still in this core's cache
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	bool ThreadPool::StealTask(int worker, Task& task)
+	{
+		for (int offset = 1; offset < m_WorkerCount; ++offset)
+		{
+			TaskQueue& queue = m_Queues[(worker + offset) % m_WorkerCount];
+			std::lock_guard lock{ queue.mutex };
+			if (queue.tasks.empty()) continue;
+
+			// Oldest first, the opposite end from the owner
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			++m_WorkerStats[worker].tasksStolen;
+			return true;
+		}
+		return false;
+	}
+
+	void ThreadPool::ExecuteTask(const Task& task, int worker)
+	{
+		TaskGraph& graph = *task.pGraph;
+
+		const auto start = std::chrono::steady_clock::now();
+		graph.m_Jobs[task.job].function(task.index, worker);
+		const auto end = std::chrono::steady_clock::now();
+
+		WorkerStats& stats = m_WorkerStats[worker];
+		++stats.tasksRun;
+		stats.busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+		if (graph.m_pRemainingTasks[task.job].fetch_sub(1, std::memory_order_acq_rel) == 1) CompleteJob(graph, task.job, worker);
+	}
+
+	void ThreadPool::ReleaseJob(TaskGraph& graph, TaskGraph::JobId job, int worker)
+	{
+		// Read only now, a job it depended on may have changed it
+		const int taskCount = graph.m_Jobs[job].taskCount;
+		if (taskCount == 0)
+		{
+			CompleteJob(graph, job, worker);
+			return;
+		}
+		graph.m_pRemainingTasks[job].store(taskCount, std::memory_order_relaxed);
+
+		// Pushed in reverse so the owner pops them in order and thieves take the far end
+		TaskQueue& queue = m_Queues[worker];
+		std::lock_guard lock{ queue.mutex };
+		for (int index = taskCount - 1; index >= 0; --index) queue.tasks.push_back({ &graph, job, index });
+	}
+
+	void ThreadPool::CompleteJob(TaskGraph& graph, TaskGraph::JobId job, int worker)
+	{
+		for (const TaskGraph::JobId successor : graph.m_Jobs[job].successors)
+		{
+			if (graph.m_pRemainingDependencies[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) ReleaseJob(graph, successor, worker);
+		}
+
+		// Last access to the graph, Run may return and the graph be rebuilt right after
+		m_RemainingJobs.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
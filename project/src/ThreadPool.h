@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	// Jobs of independent tasks, a job starts once every job it depends on has finished.
+	// Built once per frame and run by a ThreadPool.
+	class TaskGraph final
+	{
+	public:
+		using JobId = uint32_t;
+		// Called with the task index within the job and the index of the worker running it
+		using TaskFunction = std::function<void(int task, int worker)>;
+
+		JobId AddJob(int taskCount, TaskFunction function);
+		void AddDependency(JobId before, JobId after);
+		// For work only known once the graph runs, called by a task of a job this one depends on
+		void SetTaskCount(JobId job, int taskCount);
+		void Clear();
+
+		bool IsEmpty() const
+		{
+			return m_Jobs.empty();
+		}
+
+	private:
+		friend class ThreadPool;
+
+		struct Job
+		{
+			int taskCount;
+			TaskFunction function;
+			std::vector<JobId> successors;
+			int dependencyCount;
+		};
+		std::vector<Job> m_Jobs;
+
+		// Counted down while running, sized to the job count by ThreadPool::Run
+		std::unique_ptr<std::atomic<int>[]> m_pRemainingTasks;
+		std::unique_ptr<std::atomic<int>[]> m_pRemainingDependencies;
+		size_t m_CounterCapacity{};
+	};
+
+	// Persistent workers, each pinned to its own core and kept for the lifetime of the pool.
+	// Ready tasks go to the queue of the worker that released them, idle workers steal from the other end.
+	class ThreadPool final
+	{
+	public:
+		// The worker count includes the thread calling Run, 0 uses every hardware thread
+		explicit ThreadPool(int workerCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		// Returns once every task of the graph has run, the calling thread works as worker 0 meanwhile.
+		// Not reentrant, tasks must not call Run or ParallelFor themselves.
+		void Run(TaskGraph& graph);
+		// One job of taskCount tasks
+		void ParallelFor(int taskCount, const TaskGraph::TaskFunction& function);
+
+		int GetWorkerCount() const
+		{
+			return m_WorkerCount;
+		}
+
+		struct alignas(64) WorkerStats
+		{
+			uint64_t tasksRun{};
+			// Tasks taken from another worker's queue
+			uint64_t tasksStolen{};
+			int64_t busyNanoseconds{};
+		};
+		// Accumulated since the last ResetStats, only read while no graph runs
+		const std::vector<WorkerStats>& GetWorkerStats() const
+		{
+			return m_WorkerStats;
+		}
+		void ResetStats();
+
+	private:
+		struct Task
+		{
+			TaskGraph* pGraph;
+			TaskGraph::JobId job;
+			int index;
+		};
+		struct alignas(64) TaskQueue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		void WorkerLoop(int worker);
+		// Runs and steals tasks until the current graph is done
+		void RunTasks(int worker);
+		bool PopTask(int worker, Task& task);
+		bool StealTask(int worker, Task& task);
+		void ExecuteTask(const Task& task, int worker);
+		void ReleaseJob(TaskGraph& graph, TaskGraph::JobId job, int worker);
+		void CompleteJob(TaskGraph& graph, TaskGraph::JobId job, int worker);
+
+		int m_WorkerCount{};
+		std::vector<std::thread> m_Threads;
+		std::vector<TaskQueue> m_Queues;
+		std::vector<WorkerStats> m_WorkerStats;
+		TaskGraph m_ParallelForGraph;
+
+		// Jobs of the running graph that have not finished, the graph is done at 0
+		std::atomic<int> m_RemainingJobs{};
+
+		// Workers sleep between graphs and wake when the generation changes
+		std::mutex m_WakeMutex;
+		std::condition_variable m_WakeCondition;
+		uint64_t m_Generation{};
+		bool m_IsStopping{};
+	};
+}
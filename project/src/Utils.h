@@ -1,6 +1,7 @@
 #pragma once
 #include <cassert>
 #include <fstream>
+#include <algorithm>
 #include "Maths.h"
 #include "DataTypes.h"
 
@@ -171,6 +172,172 @@ namespace dae
 			return true;
 #endif
 		}
+
+		//Splits the lod's triangle list into clusters of at most maxTriangles triangles referencing at most maxVertices unique vertices
+		//Expects CalculateBounds to have been called on the mesh
+		static void BuildMeshlets(const Mesh& mesh, MeshLod& lod, uint32_t maxVertices = MAX_MESHLET_VERTICES, uint32_t maxTriangles = MAX_MESHLET_TRIANGLES)
+		{
+			assert(maxVertices < 0xFF && "Meshlet local indices are stored as uint8_t, 0xFF is reserved");
+
+			lod.meshlets.clear();
+			lod.meshletVertices.clear();
+			lod.meshletTriangles.clear();
+
+			// Local index of each mesh vertex in the meshlet being built, 0xFF = not referenced yet
+			std::vector<uint8_t> localIndices(mesh.vertices.size(), 0xFF);
+
+			auto finishMeshlet = [&](Meshlet& meshlet)
+			{
+				if (meshlet.triangleCount == 0) return;
+
+				// Bounds
+				BoundingBox box{ mesh.vertices[lod.meshletVertices[meshlet.vertexOffset]].position, mesh.vertices[lod.meshletVertices[meshlet.vertexOffset]].position };
+				for (uint32_t i{ 0 }; i < meshlet.vertexCount; ++i)
+				{
+					const Vector3& position = mesh.vertices[lod.meshletVertices[meshlet.vertexOffset + i]].position;
+					box.min = { std::min(box.min.x, position.x), std::min(box.min.y, position.y), std::min(box.min.z, position.z) };
+					box.max = { std::max(box.max.x, position.x), std::max(box.max.y, position.y), std::max(box.max.z, position.z) };
+
+					localIndices[lod.meshletVertices[meshlet.vertexOffset + i]] = 0xFF;
+				}
+				meshlet.boundingSphere.center = (box.min + box.max) * 0.5f;
+				for (uint32_t i{ 0 }; i < meshlet.vertexCount; ++i)
+				{
+					const Vector3& position = mesh.vertices[lod.meshletVertices[meshlet.vertexOffset + i]].position;
+					meshlet.boundingSphere.radius = std::max(meshlet.boundingSphere.radius, (position - meshlet.boundingSphere.center).Magnitude());
+				}
+
+				// Normal cone, axis is the average face normal and the cutoff the sine of the widest deviation from it
+				std::vector<Vector3> faceNormals{};
+				faceNormals.reserve(meshlet.triangleCount);
+				Vector3 axis{};
+				for (uint32_t i{ 0 }; i < meshlet.triangleCount; ++i)
+				{
+					const uint8_t* pTriangle = &lod.meshletTriangles[meshlet.triangleOffset + i * 3];
+					const Vector3& p0 = mesh.vertices[lod.meshletVertices[meshlet.vertexOffset + pTriangle[0]]].position;
+					const Vector3& p1 = mesh.vertices[lod.meshletVertices[meshlet.vertexOffset + pTriangle[1]]].position;
+					const Vector3& p2 = mesh.vertices[lod.meshletVertices[meshlet.vertexOffset + pTriangle[2]]].position;
+
+					const Vector3 normal = Vector3::Cross(p1 - p0, p2 - p0);
+					const float area = normal.Magnitude();
+					if (area <= FLT_EPSILON) continue;
+
+					faceNormals.emplace_back(normal / area);
+					axis += faceNormals.back();
+				}
+
+				meshlet.coneCutoff = 1.f;
+				if (!faceNormals.empty() && axis.SqrMagnitude() > FLT_EPSILON)
+				{
+					axis.Normalize();
+					float minDot{ 1.f };
+					for (const Vector3& normal : faceNormals)
+					{
+						minDot = std::min(minDot, Vector3::Dot(axis, normal));
+					}
+
+					// Cones wider than ~84 degrees almost never reject anything
+					if (minDot > 0.1f)
+					{
+						meshlet.coneAxis = axis;
+						meshlet.coneCutoff = sqrtf(1.f - minDot * minDot);
+					}
+				}
+
+				lod.meshlets.push_back(meshlet);
+				meshlet = Meshlet{ static_cast<uint32_t>(lod.meshletVertices.size()), 0, static_cast<uint32_t>(lod.meshletTriangles.size()), 0 };
+			};
+
+			struct ClusterTriangle
+			{
+				uint32_t indices[3];
+				uint64_t key;
+			};
+			std::vector<ClusterTriangle> triangles{};
+
+			const size_t triangleCount = lod.indices.size() / 3;
+			triangles.reserve(triangleCount);
+			for (size_t triangle{ 0 }; triangle < triangleCount; ++triangle)
+			{
+				ClusterTriangle clusterTriangle{};
+				clusterTriangle.indices[0] = lod.indices[triangle * 3];
+				clusterTriangle.indices[1] = lod.indices[triangle * 3 + 1];
+				clusterTriangle.indices[2] = lod.indices[triangle * 3 + 2];
+
+				// Skip degenerate triangles
+				if (clusterTriangle.indices[0] == clusterTriangle.indices[1] || clusterTriangle.indices[1] == clusterTriangle.indices[2] || clusterTriangle.indices[2] == clusterTriangle.indices[0]) continue;
+
+				triangles.push_back(clusterTriangle);
+			}
+
+			// Sort by normal direction bucket first and by a Morton code of the centroid second,
+			// so consecutive triangles are close together and face roughly the same way (tight cones)
+			const Vector3 extent = mesh.boundingBox.max - mesh.boundingBox.min;
+			auto spreadBits = [](uint64_t v)
+			{
+				v &= 0x3FF;
+				v = (v | (v << 16)) & 0x30000FF;
+				v = (v | (v << 8)) & 0x300F00F;
+				v = (v | (v << 4)) & 0x30C30C3;
+				v = (v | (v << 2)) & 0x9249249;
+				return v;
+			};
+			for (ClusterTriangle& triangle : triangles)
+			{
+				const Vector3& p0 = mesh.vertices[triangle.indices[0]].position;
+				const Vector3& p1 = mesh.vertices[triangle.indices[1]].position;
+				const Vector3& p2 = mesh.vertices[triangle.indices[2]].position;
+				const Vector3 normal = Vector3::Cross(p1 - p0, p2 - p0);
+
+				// Dominant axis (3) times the signs of the normal (8)
+				const float absX = fabsf(normal.x), absY = fabsf(normal.y), absZ = fabsf(normal.z);
+				const uint64_t axis = (absX >= absY && absX >= absZ) ? 0 : (absY >= absZ ? 1 : 2);
+				const uint64_t signs = (normal.x < 0.f ? 1 : 0) | (normal.y < 0.f ? 2 : 0) | (normal.z < 0.f ? 4 : 0);
+
+				const Vector3 centroid = (p0 + p1 + p2) / 3.f;
+				auto quantize = [](float value, float min, float size)
+				{
+					return static_cast<uint64_t>(Clamp(size > 0.f ? (value - min) / size : 0.f, 0.f, 1.f) * 1023.f);
+				};
+				const uint64_t morton = spreadBits(quantize(centroid.x, mesh.boundingBox.min.x, extent.x))
+					| (spreadBits(quantize(centroid.y, mesh.boundingBox.min.y, extent.y)) << 1)
+					| (spreadBits(quantize(centroid.z, mesh.boundingBox.min.z, extent.z)) << 2);
+
+				triangle.key = ((axis * 8 + signs) << 30) | morton;
+			}
+			std::stable_sort(triangles.begin(), triangles.end(), [](const ClusterTriangle& a, const ClusterTriangle& b) { return a.key < b.key; });
+
+			Meshlet meshlet{};
+			uint64_t currentBucket{ 0 };
+			for (const ClusterTriangle& triangle : triangles)
+			{
+				uint32_t newVertices{ 0 };
+				for (uint32_t index : triangle.indices)
+				{
+					if (localIndices[index] == 0xFF) ++newVertices;
+				}
+
+				const uint64_t bucket = triangle.key >> 30;
+				if (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount == maxTriangles
+					|| (meshlet.triangleCount > 0 && bucket != currentBucket))
+				{
+					finishMeshlet(meshlet);
+				}
+				currentBucket = bucket;
+
+				for (uint32_t index : triangle.indices)
+				{
+					if (localIndices[index] == 0xFF)
+					{
+						localIndices[index] = static_cast<uint8_t>(meshlet.vertexCount++);
+						lod.meshletVertices.push_back(index);
+					}
+					lod.meshletTriangles.push_back(localIndices[index]);
+				}
+				++meshlet.triangleCount;
+			}
+			finishMeshlet(meshlet);
+		}
 #pragma warning(pop)
 	}
 }
\ No newline at end of file
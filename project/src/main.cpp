@@ -54,6 +54,9 @@ int main(int argc, char* args[])
 	// TODO pTimer->StartBenchmark();
 
 	float printTimer = 0.f;
+	uint64_t lastPresented = 0;
+	uint64_t lastDropped = 0;
+	uint64_t lastSkipped = 0;
 	bool isLooping = true;
 	bool takeScreenshot = false;
 	while (isLooping)
@@ -67,6 +70,11 @@ int main(int argc, char* args[])
 			case SDL_QUIT:
 				isLooping = false;
 				break;
+			case SDL_WINDOWEVENT:
+				// Frames are only presented when something changed, so one uncovered in between is shown again
+				if (e.window.event == SDL_WINDOWEVENT_EXPOSED)
+					pRenderer->RefreshWindow();
+				break;
 			case SDL_KEYUP:
 				if (e.key.keysym.scancode == SDL_SCANCODE_X)
 					takeScreenshot = true;
@@ -125,13 +133,178 @@ int main(int argc, char* args[])
 						pRenderer->SetDisplayMode(Renderer::DisplayMode::ShadingMode);
 					}
 				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+				{
+					pRenderer->CycleScene();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+				{
+					if (pRenderer->GetIsLodEnabled())
+					{
+						std::cout << "Level of detail: OFF" << std::endl;
+						pRenderer->SetIsLodEnabled(false);
+					}
+					else
+					{
+						std::cout << "Level of detail: ON" << std::endl;
+						pRenderer->SetIsLodEnabled(true);
+					}
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+				{
+					if (pRenderer->GetIsOcclusionCulling())
+					{
+						std::cout << "Occlusion culling: OFF" << std::endl;
+						pRenderer->SetIsOcclusionCulling(false);
+					}
+					else
+					{
+						std::cout << "Occlusion culling: ON" << std::endl;
+						pRenderer->SetIsOcclusionCulling(true);
+					}
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+				{
+					pRenderer->CycleRenderPath();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F1)
+				{
+					pRenderer->CyclePresentMode();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F2)
+				{
+					if (pRenderer->GetIsPipelined())
+					{
+						std::cout << "Pipelined frames: OFF" << std::endl;
+						pRenderer->SetIsPipelined(false);
+					}
+					else
+					{
+						std::cout << "Pipelined frames: ON" << std::endl;
+						pRenderer->SetIsPipelined(true);
+					}
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F3)
+				{
+					if (pRenderer->GetIsDepthSorted())
+					{
+						std::cout << "Front-to-back sorting: OFF" << std::endl;
+						pRenderer->SetIsDepthSorted(false);
+					}
+					else
+					{
+						std::cout << "Front-to-back sorting: ON" << std::endl;
+						pRenderer->SetIsDepthSorted(true);
+					}
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_Z)
+				{
+					pRenderer->CycleDepthFormat();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_R)
+				{
+					if (pRenderer->GetIsReversedZ())
+					{
+						std::cout << "Reversed-Z: OFF" << std::endl;
+						pRenderer->SetIsReversedZ(false);
+					}
+					else
+					{
+						std::cout << "Reversed-Z: ON" << std::endl;
+						pRenderer->SetIsReversedZ(true);
+					}
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_I)
+				{
+					if (pRenderer->GetIsInfiniteFar())
+					{
+						std::cout << "Infinite far plane: OFF" << std::endl;
+						pRenderer->SetIsInfiniteFar(false);
+					}
+					else
+					{
+						std::cout << "Infinite far plane: ON" << std::endl;
+						pRenderer->SetIsInfiniteFar(true);
+					}
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_V)
+				{
+					pRenderer->CycleShadingRate();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_C)
+				{
+					if (pRenderer->GetIsReprojectionCache())
+					{
+						std::cout << "Reprojection cache: OFF" << std::endl;
+						pRenderer->SetIsReprojectionCache(false);
+					}
+					else
+					{
+						std::cout << "Reprojection cache: ON" << std::endl;
+						pRenderer->SetIsReprojectionCache(true);
+					}
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_K)
+				{
+					if (pRenderer->GetIsFrameSkipping())
+					{
+						std::cout << "Frame skipping: OFF" << std::endl;
+						pRenderer->SetIsFrameSkipping(false);
+					}
+					else
+					{
+						std::cout << "Frame skipping: ON" << std::endl;
+						pRenderer->SetIsFrameSkipping(true);
+					}
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_M)
+				{
+					if (pRenderer->GetIsMsaa())
+					{
+						std::cout << "MSAA 4x: OFF" << std::endl;
+						pRenderer->SetIsMsaa(false);
+					}
+					else
+					{
+						std::cout << "MSAA 4x: ON" << std::endl;
+						pRenderer->SetIsMsaa(true);
+					}
+					// The sample buffers are only allocated while MSAA is on
+					std::cout << "Render targets: " << pRenderer->GetRenderTargetBytes() / (1024.f * 1024.f) << " MB" << std::endl;
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_U)
+				{
+					if (pRenderer->GetIsDynamicResolution())
+					{
+						std::cout << "Dynamic resolution: OFF" << std::endl;
+						pRenderer->SetIsDynamicResolution(false);
+					}
+					else
+					{
+						std::cout << "Dynamic resolution: ON" << std::endl;
+						pRenderer->SetIsDynamicResolution(true);
+					}
+				}
 				break;
 			}
 		}
 
+		// Frames paced to the display are copied to the window here, the present thread may not touch it
+		pRenderer->UpdateWindow();
+
 		//--------- Update ---------
 		pRenderer->Update(pTimer);
 
+		// Nothing moved and no setting changed, so the loop sleeps until input arrives instead of rendering the same frame.
+		// A screenshot asked for is still taken first. The event that ends the wait stays queued for the next iteration's poll.
+		// The timer is paused meanwhile so the wait does not count as frame time.
+		if (pRenderer->GetIsFrameSkipping() && !pRenderer->IsFrameDirty() && !takeScreenshot)
+		{
+			pTimer->Stop();
+			SDL_WaitEvent(nullptr);
+			pTimer->Start();
+		}
+
 		//--------- Render ---------
 		pRenderer->Render();
 
@@ -141,7 +314,54 @@ int main(int argc, char* args[])
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			const auto& frameStats = pRenderer->GetFrameStats();
+			std::cout << "dFPS: " << pTimer->GetdFPS() << ", frame latency: " << frameStats.latencyNanoseconds / 1000000.f << " ms" << std::endl;
+			std::cout << "Render scale: " << static_cast<int>(frameStats.renderScale * 100.f + .5f) << "% (" << frameStats.renderWidth << "x" << frameStats.renderHeight
+				<< (pRenderer->GetIsDynamicResolution() ? ", dynamic" : ", fixed") << ")" << std::endl;
+
+			// Frames that reached the window since the last print, the ones a newer frame replaced first and the ones not rendered since nothing changed
+			const auto& swapChain = pRenderer->GetSwapChain();
+			std::cout << "Presented: " << swapChain.GetPresentedCount() - lastPresented
+				<< ", dropped: " << swapChain.GetDroppedCount() - lastDropped
+				<< ", skipped: " << pRenderer->GetSkippedFrameCount() - lastSkipped << std::endl;
+			lastPresented = swapChain.GetPresentedCount();
+			lastDropped = swapChain.GetDroppedCount();
+			lastSkipped = pRenderer->GetSkippedFrameCount();
+
+			std::cout << "Instances drawn: " << frameStats.instancesTotal - frameStats.instancesCulled - frameStats.instancesOccluded
+				<< "/" << frameStats.instancesTotal
+				<< " (" << frameStats.instancesOccluded << " occluded by " << frameStats.occluders << " occluders"
+				<< (frameStats.isOcclusionReprojected ? " and last frame's depth" : "") << ")"
+				<< ", meshlets drawn: " << frameStats.meshletsTotal - frameStats.meshletsCulled
+				<< "/" << frameStats.meshletsTotal
+				<< ", triangles rasterized: " << frameStats.trianglesRasterized
+				<< ", pixels shaded: " << frameStats.pixelsShaded
+				<< ", fragments rejected early: " << frameStats.fragmentsRejected << std::endl;
+			std::cout << "Tiles shaded at 1x1/2x2/4x4: " << frameStats.tilesPerShadingRate[0] << "/" << frameStats.tilesPerShadingRate[1]
+				<< "/" << frameStats.tilesPerShadingRate[2] << ", pixels copied from their coarse block: " << frameStats.pixelsBroadcast << std::endl;
+			if (pRenderer->GetIsReprojectionCache())
+			{
+				std::cout << "Reprojection cache hit rate: " << (frameStats.pixelsReprojected > 0 ? 100 * frameStats.pixelsReused / frameStats.pixelsReprojected : 0)
+					<< "% (" << frameStats.pixelsReused << "/" << frameStats.pixelsReprojected << " pixels reused)" << std::endl;
+			}
+			for (size_t lod = 0; lod < MAX_MESH_LODS; ++lod)
+			{
+				if (frameStats.lodInstances[lod] == 0) continue;
+				std::cout << "  LOD" << lod << ": " << frameStats.lodInstances[lod] << " instances, "
+					<< frameStats.lodTriangles[lod] << " triangles submitted" << std::endl;
+			}
+
+			// Share of the last frame each worker spent running tasks
+			const auto& workerStats = pRenderer->GetWorkerStats();
+			std::cout << "Workers:";
+			for (size_t worker = 0; worker < workerStats.size(); ++worker)
+			{
+				const int utilization = frameStats.renderNanoseconds > 0
+					? static_cast<int>(100 * workerStats[worker].busyNanoseconds / frameStats.renderNanoseconds) : 0;
+				std::cout << " " << worker << ": " << utilization << "% (" << workerStats[worker].tasksRun << " tasks, "
+					<< workerStats[worker].tasksStolen << " stolen)";
+			}
+			std::cout << std::endl;
 		}
 
 		//Save screenshot after full render